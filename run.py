@@ -1,12 +1,16 @@
 import subprocess
+import sys
 import os
 
 
 command = ["powershell", "g++"]
 
-flags = ["-g", "-O3", "-Wall", "-Wextra", "-pedantic", "-w"]
+flags = ["-g", "-O3", "-Wall", "-Wextra", "-pedantic", "-w", "-pthread"]
 include = [""]
 
+# 'python run.py lib' builds the C API as libreaver.a and a shared library instead of main
+library = len(sys.argv) > 1 and sys.argv[1] == "lib"
+
 source_files = []
 
 path = "src/"
@@ -15,11 +19,29 @@ for root, d_names, f_names in os.walk(path):
         for name in f_names:
             dot = name.find(".")
             if name[dot+1:] == "cpp" and name != "bindings.cpp":
+                # interface.cpp holds main(), the library has no use for it
+                if library and name == "interface.cpp":
+                    continue
                 source_files.append(f"{root}/{name}")
 
-command.extend(source_files)
-command.extend(flags)
-command.extend(include)
-command.extend(["-o", "main.exe"])
+if library:
+    shared = "reaver.dll" if os.name == "nt" else "libreaver.so"
+
+    objects = []
+    for source in source_files:
+        obj = os.path.splitext(os.path.basename(source))[0] + ".o"
+        subprocess.run(command + ["-c", source, "-fPIC", "-o", obj] + flags)
+        objects.append(obj)
+
+    subprocess.run(["ar", "rcs", "libreaver.a"] + objects)
+    subprocess.run(command + ["-shared", "-o", shared] + objects + flags)
+
+    for obj in objects:
+        os.remove(obj)
+else:
+    command.extend(source_files)
+    command.extend(flags)
+    command.extend(include)
+    command.extend(["-o", "main.exe"])
 
-subprocess.run(command)
+    subprocess.run(command)
@@ -1,4 +1,14 @@
 #include "chess.h"
+#include <mutex>
+
+Magic Chess::bishopMagics[64];
+Magic Chess::rookMagics[64];
+Bitboard Chess::bishopAttackTable[5248];
+Bitboard Chess::rookAttackTable[102400];
+Bitboard Chess::betweenMasks[64][64];
+Bitboard Chess::lineMasks[64][64];
+
+static std::once_flag magicsInitialised;
 
 void Chess::initAttackTables() {
     for (int sq = 0; sq < 64; ++sq) {
@@ -57,93 +67,118 @@ void Chess::initAttackTables() {
         for (int f=file, r=rank-1; r>0; r--) rookMasks[sq] |= getWithSetBit(r*8 + f);
         for (int f=file+1, r=rank; f<7; f++) rookMasks[sq] |= getWithSetBit(r*8 + f);
     }
+
+    std::call_once(magicsInitialised, [this]() {
+        initMagics();
+        initLineMasks();
+    });
 }
 
-Bitboard Chess::rookAttacks(int square, Bitboard occ) {
+// Ray walk used only to fill the magic tables
+static Bitboard slidingAttacks(int square, Bitboard occ, const int directions[4][2]) {
     Bitboard attacks = 0ULL;
     int rank = square / 8;
     int file = square % 8;
 
-    // NORTH
-    for (int r = rank + 1; r < 8; ++r) {
-        int sq = r * 8 + file;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
-    }
-
-    // SOUTH
-    for (int r = rank - 1; r >= 0; --r) {
-        int sq = r * 8 + file;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
+    for (int d = 0; d < 4; ++d) {
+        for (int r = rank + directions[d][0], f = file + directions[d][1]; r >= 0 && r < 8 && f >= 0 && f < 8; r += directions[d][0], f += directions[d][1]) {
+            attacks |= (1ULL << (r * 8 + f));
+            if (occ & (1ULL << (r * 8 + f))) break;
+        }
     }
 
-    // EAST
-    for (int f = file + 1; f < 8; ++f) {
-        int sq = rank * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
-    }
+    return attacks;
+}
 
-    // WEST
-    for (int f = file - 1; f >= 0; --f) {
-        int sq = rank * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
+static Bitboard randomSparse(Bitboard& seed) {
+    Bitboard r = 0ULL;
+    for (int i = 0; i < 3; i++) {
+        // xorshift64*
+        seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+        r = (i == 0) ? seed * 2685821657736338717ULL : r & (seed * 2685821657736338717ULL);
     }
-
-    return attacks;
+    return r;
 }
 
-Bitboard Chess::bishopAttacks(int square, Bitboard occ) {
-    Bitboard attacks = 0ULL;
-    int rank = square / 8;
-    int file = square % 8;
+static void findMagics(Magic* magics, Bitboard* table, Bitboard* masks, const int directions[4][2]) {
+    // Per-rank seeds known to converge quickly with this generator
+    static const Bitboard seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+
+    Bitboard occupancy[4096];
+    Bitboard reference[4096];
+    int epoch[4096] = {};
+    int attempt = 0;
+
+    Bitboard* next = table;
+    for (int sq = 0; sq < 64; sq++) {
+        Magic& m = magics[sq];
+        m.mask = masks[sq];
+        m.shift = 64 - __builtin_popcountll(m.mask);
+        m.attacks = next;
+        Bitboard seed = seeds[sq / 8];
+
+        // Enumerate every subset of the mask (Carry-Rippler)
+        int size = 0;
+        Bitboard subset = 0ULL;
+        do {
+            occupancy[size] = subset;
+            reference[size] = slidingAttacks(sq, subset, directions);
+            size++;
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        for (int i = 0; i < size;) {
+            do {
+                m.magic = randomSparse(seed);
+            } while (__builtin_popcountll((m.mask * m.magic) >> 56) < 6);
+
+            attempt++;
+            for (i = 0; i < size; i++) {
+                unsigned index = ((occupancy[i] & m.mask) * m.magic) >> m.shift;
+                if (epoch[index] < attempt) {
+                    epoch[index] = attempt;
+                    m.attacks[index] = reference[i];
+                } else if (m.attacks[index] != reference[i]) {
+                    break;
+                }
+            }
+        }
 
-    // NE
-    for (int r = rank + 1, f = file + 1; r < 8 && f < 8; ++r, ++f) {
-        int sq = r * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
+        next += size;
     }
+}
 
-    // NW
-    for (int r = rank + 1, f = file - 1; r < 8 && f >= 0; ++r, --f) {
-        int sq = r * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
-    }
+void Chess::initMagics() {
+    static const int bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    static const int rookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
 
-    // SE
-    for (int r = rank - 1, f = file + 1; r >= 0 && f < 8; --r, ++f) {
-        int sq = r * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
-    }
+    findMagics(bishopMagics, bishopAttackTable, bishopMasks, bishopDirections);
+    findMagics(rookMagics, rookAttackTable, rookMasks, rookDirections);
+}
 
-    // SW
-    for (int r = rank - 1, f = file - 1; r >= 0 && f >= 0; --r, --f) {
-        int sq = r * 8 + f;
-        if (occ & (1ULL << sq)){
-            attacks |= (1ULL << sq);
-            break;
-        } 
+void Chess::initLineMasks() {
+    for (int s1 = 0; s1 < 64; s1++) {
+        for (int s2 = 0; s2 < 64; s2++) {
+            Bitboard b1 = getWithSetBit(s1);
+            Bitboard b2 = getWithSetBit(s2);
+
+            if (s1 != s2 && (rookAttacks(s1, 0ULL) & b2)) {
+                lineMasks[s1][s2] = (rookAttacks(s1, 0ULL) & rookAttacks(s2, 0ULL)) | b1 | b2;
+                betweenMasks[s1][s2] = rookAttacks(s1, b2) & rookAttacks(s2, b1);
+            } else if (s1 != s2 && (bishopAttacks(s1, 0ULL) & b2)) {
+                lineMasks[s1][s2] = (bishopAttacks(s1, 0ULL) & bishopAttacks(s2, 0ULL)) | b1 | b2;
+                betweenMasks[s1][s2] = bishopAttacks(s1, b2) & bishopAttacks(s2, b1);
+            }
+        }
     }
+}
 
-    return attacks;
+Bitboard Chess::rookAttacks(int square, Bitboard occ) {
+    const Magic& m = rookMagics[square];
+    return m.attacks[((occ & m.mask) * m.magic) >> m.shift];
 }
 
+Bitboard Chess::bishopAttacks(int square, Bitboard occ) {
+    const Magic& m = bishopMagics[square];
+    return m.attacks[((occ & m.mask) * m.magic) >> m.shift];
+}
@@ -0,0 +1,115 @@
+#include "chess.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <cctype>
+#include <stdexcept>
+
+static const std::string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// The board fields of an EPD or FEN line, EPD opcodes dropped and missing counters filled in
+static std::string fenFromLine(const std::string& line) {
+    std::stringstream tokens(line);
+    std::string token, fen;
+
+    for (int i = 0; i < 4 && tokens >> token; i++) fen += (i ? " " : "") + token;
+
+    std::string halfmove, fullmove;
+    if (tokens >> halfmove >> fullmove && std::all_of(halfmove.begin(), halfmove.end(), ::isdigit)
+                                        && std::all_of(fullmove.begin(), fullmove.end(), ::isdigit))
+        return fen + " " + halfmove + " " + fullmove;
+
+    return fen + " 0 1";
+}
+
+// Searches every position in the file ("-" for stdin) on its own engine per worker and prints
+// one tab separated line per position, in input order:
+// fen, best move, score, depth, nodes, milliseconds
+int runBatch(const std::string& path, const SearchLimits& limits, int threads, size_t hashMegabytes) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Could not open " << path << std::endl;
+            return 2;
+        }
+    }
+    std::istream& input = path == "-" ? std::cin : file;
+
+    std::mutex inputMutex, outputMutex;
+    size_t nextIndex = 0, nextToPrint = 0;
+    std::map<size_t, std::string> pending; // Finished out of order, waiting for earlier positions
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        TranspositionTable table;
+        table.resize(hashMegabytes);
+
+        Chess* board = new Chess();
+        board->init(startFen);
+        board->tt = &table;
+
+        while (true) {
+            std::string line;
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(inputMutex);
+                bool found = false;
+                while (getline(input, line)) {
+                    size_t first = line.find_first_not_of(" \t\r");
+                    if (first == std::string::npos || line[first] == '#') continue;
+                    found = true;
+                    break;
+                }
+                if (!found) break;
+                index = nextIndex++;
+            }
+
+            std::string fen = fenFromLine(line);
+            std::string result;
+            try {
+                if (!Chess::isValidFen(fen)) throw std::invalid_argument("invalid FEN");
+
+                // Start every position cold, so results don't depend on what this worker searched before
+                table.clear();
+                memset(board->history, 0, sizeof(board->history));
+                board->loadFen(fen);
+                SearchResult searched = board->search(limits, false);
+
+                std::stringstream out;
+                out << fen << '\t' << (searched.bestMove ? board->notationFromSquare(searched.bestMove) : "0000") << '\t'
+                    << board->formatScore(searched.score) << '\t' << searched.depth << '\t' << searched.nodes << '\t'
+                    << (uint64_t)searched.ms;
+                result = out.str();
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                totalNodes += searched.nodes;
+            } catch (const std::exception& e) {
+                result = fen + "\terror";
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            pending[index] = result;
+            for (auto it = pending.find(nextToPrint); it != pending.end(); it = pending.find(++nextToPrint)) {
+                std::cout << it->second << '\n';
+                pending.erase(it);
+            }
+            std::cout.flush();
+        }
+
+        delete board;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, threads); t++) pool.emplace_back(worker);
+    for (std::thread& t : pool) t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << nextIndex << " positions, " << totalNodes << " nodes in " << seconds << "s, "
+              << (uint64_t)(nextIndex / std::max(seconds, 1e-3)) << " positions/s" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "chess.h"
+#include "reaver.h"
+#include <new>
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct ReaverEngine {
+    Chess board;
+    TranspositionTable table;
+    std::atomic<bool> stop{false};
+};
+
+ReaverEngine* reaver_create(size_t hashMegabytes) {
+    ReaverEngine* engine = new (std::nothrow) ReaverEngine();
+    if (!engine) return nullptr;
+
+    try {
+        engine->board.init(startFen);
+        engine->board.stopSignal = &engine->stop;
+        if (hashMegabytes) {
+            engine->table.resize(hashMegabytes);
+            engine->board.tt = &engine->table;
+        }
+        engine->board.pawnTable.probe(0); // Allocate now rather than in the first search
+        engine->board.gameStateStack.resize(REAVER_MAX_GAME_PLIES + MAX_PLY + 1); // The game and a search on top, never grown
+    } catch (const std::bad_alloc&) {
+        delete engine;
+        return nullptr;
+    }
+
+    return engine;
+}
+
+void reaver_destroy(ReaverEngine* engine) {
+    delete engine;
+}
+
+int reaver_set_fen(ReaverEngine* engine, const char* fen) {
+    if (!engine || !fen || !Chess::isValidFen(fen)) return REAVER_INVALID_ARGUMENT;
+    engine->board.loadFen(fen);
+    return REAVER_OK;
+}
+
+size_t reaver_get_fen(ReaverEngine* engine, char* buffer, size_t size) {
+    if (!engine) return 0;
+    return engine->board.writeFen(buffer, buffer ? size : 0);
+}
+
+int reaver_legal_moves(ReaverEngine* engine, ReaverMove* moves, int capacity) {
+    if (!engine) return REAVER_INVALID_ARGUMENT;
+
+    Move moveBuffer[MAX_MOVES];
+    int count = engine->board.GenerateLegalMoves(moveBuffer);
+    if (moves) memcpy(moves, moveBuffer, std::min(count, std::max(capacity, 0)) * sizeof(Move));
+    return count;
+}
+
+int reaver_make_move(ReaverEngine* engine, ReaverMove move) {
+    if (!engine) return REAVER_INVALID_ARGUMENT;
+    Chess& board = engine->board;
+    if (board.stackPointer >= REAVER_MAX_GAME_PLIES) return REAVER_INVALID_ARGUMENT;
+
+    if (!board.isLegal(move)) return REAVER_ILLEGAL_MOVE;
+    board.makeMove(move);
+    return REAVER_OK;
+}
+
+int reaver_make_uci(ReaverEngine* engine, const char* uci) {
+    if (!engine || !uci) return REAVER_INVALID_ARGUMENT;
+    if (engine->board.stackPointer >= REAVER_MAX_GAME_PLIES) return REAVER_INVALID_ARGUMENT;
+    return engine->board.playMove(uci) ? REAVER_OK : REAVER_ILLEGAL_MOVE;
+}
+
+size_t reaver_move_to_san(ReaverEngine* engine, ReaverMove move, char* buffer, size_t size) {
+    if (!engine || !engine->board.isLegal(move)) return 0;
+    return engine->board.writeSan(move, buffer, buffer ? size : 0);
+}
+
+int reaver_unmake_move(ReaverEngine* engine) {
+    if (!engine) return REAVER_INVALID_ARGUMENT;
+    if (engine->board.stackPointer == 0) return REAVER_NO_MOVE;
+    engine->board.undoMove();
+    return REAVER_OK;
+}
+
+void reaver_move_to_uci(ReaverMove move, char* buffer) {
+    static const char promotions[4] = {'q', 'r', 'b', 'n'};
+    int from = move & SQUARE_MASK;
+    int to = (move >> TO_SHIFT) & SQUARE_MASK;
+    int flags = (move >> FLAG_SHIFT) & FLAG_MASK;
+
+    buffer[0] = 'a' + from % 8;
+    buffer[1] = '1' + from / 8;
+    buffer[2] = 'a' + to % 8;
+    buffer[3] = '1' + to / 8;
+    buffer[4] = flags >= QUEEN_PROM_FLAG ? promotions[flags - QUEEN_PROM_FLAG] : '\0';
+    buffer[5] = '\0';
+}
+
+int reaver_side_to_move(ReaverEngine* engine) {
+    return engine ? engine->board.currentTurn : 0;
+}
+
+int reaver_in_check(ReaverEngine* engine) {
+    return engine ? engine->board.isInCheck(-1, true) : 0;
+}
+
+uint64_t reaver_perft(ReaverEngine* engine, int depth) {
+    if (!engine || depth < 0 || depth > MAX_PLY) return 0;
+    return engine->board.perftNodes(depth);
+}
+
+int reaver_search(ReaverEngine* engine, const ReaverLimits* limits, ReaverSearchResult* result) {
+    if (!engine || !limits || !result) return REAVER_INVALID_ARGUMENT;
+
+    SearchLimits searchLimits;
+    searchLimits.depth = limits->depth;
+    searchLimits.nodes = limits->nodes;
+    searchLimits.movetime = limits->movetime;
+
+    engine->stop = false;
+    SearchResult searched = engine->board.search(searchLimits, false);
+
+    result->bestMove = searched.bestMove;
+    result->score = searched.score;
+    result->mate = 0;
+    if (searched.score >= MATE_BOUND) result->mate = (INF - searched.score + 1) / 2;
+    if (searched.score <= -MATE_BOUND) result->mate = -(INF + searched.score) / 2;
+    result->depth = searched.depth;
+    result->nodes = searched.nodes;
+    result->ms = searched.ms;
+
+    return searched.bestMove ? REAVER_OK : REAVER_NO_MOVE;
+}
+
+void reaver_stop(ReaverEngine* engine) {
+    if (engine) engine->stop = true;
+}
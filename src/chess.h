@@ -6,34 +6,66 @@
 #include <cstdint>
 #include <chrono>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <string_view>
 
 
 #define MAX_MOVES 256
 #define MAX_DEPTH 256
+#define MAX_PLY 64
 
 typedef uint16_t Move;
 typedef uint8_t U8;
 typedef uint64_t Bitboard;
-typedef double Eval;
+typedef uint64_t Key;
+typedef int Eval; // centipawns
 
 enum Color {BLACK, WHITE};
 enum Piece {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE};
 
+// Undo record, everything else is recovered by reversing the move on the bitboards
 struct GameState
 {
-    U8 currentTurn;
+    Move move;
+    U8 capturedPiece;
     U8 castlingRights;
     U8 enPassantSquare;
-    U8 capturedPiece;
-    U8 promotedPiece;
     uint16_t fiftyMoveRuleCounter;
+    Key hashKey;
+};
 
-    U8 kingSquare[2];
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    U8 shift;
+};
 
+// Zero means unlimited
+struct SearchLimits {
+    int depth = MAX_PLY;
+    uint64_t nodes = 0;
+    int64_t movetime = 0; // milliseconds
+};
 
-    Bitboard bitboards[6][2]={};
+struct SearchResult {
+    Move bestMove = 0;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    double ms = 0;
+};
+
+// Fixed capacity, lives on the stack
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
 
-    Bitboard whitePieces=0, blackPieces=0, allPieces=0;
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    int size() const { return count; }
+    Move operator[](int i) const { return moves[i]; }
 };
 
 struct MoveType {
@@ -51,6 +83,10 @@ struct MoveData {
 
 constexpr Bitboard notAFile = 0xfefefefefefefefeULL;
 constexpr Bitboard notHFile = 0x7f7f7f7f7f7f7f7fULL;
+constexpr Bitboard RANK_1 = 0x00000000000000ffULL;
+constexpr Bitboard RANK_4 = 0x00000000ff000000ULL;
+constexpr Bitboard RANK_5 = 0x000000ff00000000ULL;
+constexpr Bitboard RANK_8 = 0xff00000000000000ULL;
 
 constexpr U8 FROM_SHIFT = 0;
 constexpr U8 TO_SHIFT = 6;
@@ -83,7 +119,156 @@ const U8 WHITE_PROMOTION_RANK = 6;
 const U8 BLACK_PROMOTION_RANK = 1;
 
 const int INF = 1000000;
+const int MATE_BOUND = INF - MAX_DEPTH; // Scores beyond this are mates, measured in plies
+
+// pieceLocations[] entries: (piece << 1) | color
+constexpr U8 EMPTY_SQUARE = NO_PIECE << 1;
+
+
+
+// ------------------------------------------- TRANSPOSITION TABLE -------------------------------------------
+
+enum Bound {BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT};
+
+// Lockless entry, the key is stored XORed with the data so a torn write from
+// another thread fails verification instead of returning mixed data
+struct TTEntry {
+    std::atomic<uint64_t> keyXor{0};
+    std::atomic<uint64_t> data{0}; // score | move << 32 | depth << 48 | genBound << 56
+};
+
+// Unpacked copy of an entry
+struct TTData {
+    int score;
+    Move move;
+    int depth;
+    U8 bound;
+};
+
+constexpr int TT_BUCKET_SIZE = 4;
+
+// One bucket per cache line
+struct alignas(64) TTBucket {
+    TTEntry entries[TT_BUCKET_SIZE];
+};
+
+class TranspositionTable {
+
+    public:
+
+    TTBucket* buckets = nullptr;
+    size_t bucketCount = 0;
+    U8 generation = 0; // Only changed between searches
+
+    TranspositionTable() = default;
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+    ~TranspositionTable();
+
+    void resize(size_t megabytes);
+    void clear();
+    void newSearch();
+    TTBucket* bucket(Key key);
+    void prefetch(Key key);
+    bool probe(Key key, TTData& result);
+    void store(Key key, int score, Move move, int depth, U8 bound);
+
+};
+
+struct PerftEntry {
+    Key key;
+    uint64_t data; // nodes << 8 | depth
+};
+
+constexpr int PERFT_BUCKET_SIZE = 4;
+
+struct alignas(64) PerftBucket {
+    PerftEntry entries[PERFT_BUCKET_SIZE];
+};
+
+// Subtree node counts keyed by (position, depth), verified on the full key
+class PerftTable {
+
+    public:
+
+    PerftBucket* buckets = nullptr;
+    size_t bucketCount = 0;
+
+    PerftTable() = default;
+    PerftTable(const PerftTable&) = delete;
+    PerftTable& operator=(const PerftTable&) = delete;
+    ~PerftTable();
+
+    void resize(size_t megabytes);
+    void clear();
+    bool probe(Key key, int depth, uint64_t& nodes);
+    void store(Key key, int depth, uint64_t nodes);
+
+};
+
+// Pawn-structure terms and spans, White-relative, cached by the pawn-only key
+struct PawnEntry {
+    Key key;
+    int16_t mg;
+    int16_t eg;
+    Bitboard attackSpans[2]; // Every square a colour's pawns could ever attack
+    Bitboard passed[2];
+};
 
+constexpr size_t PAWN_TABLE_SIZE = 1 << 14;
+
+// Per instance and allocated on first use, a copy starts empty so search threads never share one
+class PawnTable {
+
+    public:
+
+    PawnEntry* entries = nullptr;
+
+    PawnTable() = default;
+    PawnTable(const PawnTable&) {}
+    PawnTable& operator=(const PawnTable&);
+    ~PawnTable();
+
+    PawnEntry* probe(Key key);
+
+};
+
+// The Lazy SMP helpers' pawn tables, lent to each search's helper copies so they stay warm between
+// searches. A copy starts with none.
+class HelperPawnTables {
+
+    public:
+
+    std::vector<PawnTable*> tables;
+
+    HelperPawnTables() = default;
+    HelperPawnTables(const HelperPawnTables&) {}
+    HelperPawnTables& operator=(const HelperPawnTables&) { return *this; }
+    ~HelperPawnTables() { for (PawnTable* table : tables) delete table; }
+
+};
+
+
+// ------------------------------------------------- NNUE -------------------------------------------------
+
+// (piece, square) features from both sides' point of view into one hidden layer, then one output
+constexpr int NNUE_INPUTS = 768;
+constexpr int NNUE_HIDDEN = 256;
+constexpr int NNUE_QA = 255; // Accumulator quantisation, also the clipped ReLU ceiling
+constexpr int NNUE_QB = 64; // Output weight quantisation
+constexpr int NNUE_SCALE = 400; // Network output to centipawns
+
+struct alignas(64) Network {
+    int16_t featureWeights[NNUE_INPUTS * NNUE_HIDDEN];
+    int16_t featureBias[NNUE_HIDDEN];
+    int16_t outputWeights[2 * NNUE_HIDDEN];
+    int16_t outputBias;
+};
+
+// Hidden layer sums per perspective, [color][neuron]
+struct alignas(64) Accumulator {
+    int16_t values[2][NNUE_HIDDEN];
+};
 
 
 class Chess {
@@ -106,6 +291,24 @@ class Chess {
     Bitboard bishopMasks[64];
     Bitboard rookMasks[64];
 
+    // Shared by every instance, filled once by initMagics()
+    static Magic bishopMagics[64];
+    static Magic rookMagics[64];
+    static Bitboard bishopAttackTable[5248];
+    static Bitboard rookAttackTable[102400];
+    static Bitboard betweenMasks[64][64];
+    static Bitboard lineMasks[64][64];
+
+    // Material plus piece-square values per phase, negated for Black, filled once by initEval()
+    static int mgTable[6][2][64];
+    static int egTable[6][2][64];
+
+    // Zobrist keys, shared by every instance and filled once by initZobrist()
+    static Key zobristPieces[6][2][64];
+    static Key zobristCastling[16];
+    static Key zobristEnPassant[8];
+    static Key zobristSide;
+
     char notations[6][2] = {{'P', 'p'}, {'N', 'n'}, {'B', 'b'}, {'R', 'r'}, {'Q', 'q'}, {'K', 'k'}};
     char promNotations[4] = {'q', 'r', 'b', 'n'};
 
@@ -115,25 +318,64 @@ class Chess {
     U8 castlingRights = 0; // KQkq <=> 0b1111 
     U8 enPassantSquare = 64; // -1 = no EN_PASSANT, 0 <= square < 64 {Valid Square}
     int moveRule50Count = 0;
+    int fullmoveNumber = 1;
     U8 capturedPiece = 12;
     U8 promotedPiece = 12;
-
-    GameState gameStateStack[MAX_DEPTH];
-    Move movesStack[MAX_DEPTH];
-    U8 pieceLocations[64];
+    Key hashKey = 0;
+
+    // Incremental evaluation terms, White-relative
+    int mgScore = 0;
+    int egScore = 0;
+    int phase = 0;
+    Key pawnKey = 0; // Zobrist key of the pawns alone
+    PawnTable pawnTable;
+    HelperPawnTables helperPawnTables;
+
+    // Optional network shared by every instance, the accumulator only tracks it while loaded
+    static Network* network;
+    Accumulator accumulator;
+
+    TranspositionTable* tt = nullptr; // Optional, owned by the caller
+    int threads = 1; // Lazy SMP, helpers only run when there is a table to share
+    Move bestMove = 0; // Best root move of the last negaMax call
+
+    SearchLimits limits;
+    uint64_t nodes = 0;
+    bool stopped = false;
+    const std::atomic<bool>* stopSignal = nullptr; // Optional external stop, e.g. UCI 'stop'
+    std::chrono::steady_clock::time_point searchStart;
+
+    // Move ordering
+    Move killers[MAX_PLY][2] = {};
+    int history[2][64][64] = {}; // Butterfly table, [color][from][to]
+
+    // Undo records of the game so far with the search plies on top, grows for long games
+    std::vector<GameState> gameStateStack = std::vector<GameState>(MAX_DEPTH);
+    U8 pieceLocations[64]; // Square-to-piece mailbox, kept in sync with the bitboards
 
     int stackPointer = 0;
+    int searchRoot = 0; // stackPointer at the root of the current search
 
     const U8 NOT_OVER = 0;
     const U8 CHECK_MATE = 1;
     const U8 STALE_MATE = 2;
-
-    const int PAWN_VALUE = 1;
-    const int KNIGHT_VALUE = 3;
-    const int BISHOP_VALUE = 3;
-    const int ROOK_VALUE = 5;
-    const int QUEEN_VALUE = 9;
+    const U8 REPETITION = 3;
+    const U8 FIFTY_MOVES = 4;
+
+    const int PAWN_VALUE = 100;
+    const int KNIGHT_VALUE = 320;
+    const int BISHOP_VALUE = 330;
+    const int ROOK_VALUE = 500;
+    const int QUEEN_VALUE = 900;
     const int KING_VALUE = 0;
+    const int pieceValues[7] = {PAWN_VALUE, KNIGHT_VALUE, BISHOP_VALUE, ROOK_VALUE, QUEEN_VALUE, KING_VALUE, 0};
+
+    static constexpr int phaseWeights[7] = {0, 1, 1, 2, 4, 0, 0};
+    static constexpr int TOTAL_PHASE = 24;
+    static Bitboard shieldMasks[2][64]; // Two ranks in front of the king, three files wide
+
+    const int DELTA_MARGIN = 200; // Slack for positional gains when delta pruning captures
+    bool quiescenceEvasions = true; // Search all evasions when in check inside quiescence
 
     // Fetching Data
     // 1) move related
@@ -158,14 +400,25 @@ class Chess {
     // 3) board related
     std::string getPromotionNotation(Move& move);
     std::string getFen();
+    size_t writeFen(char* buffer, size_t size);
     
 
     // Handling moves
     Move constructMove(U8 from, U8 to, U8 castleStatus, U8 flags);
+    void putPiece(U8 piece, U8 color, U8 square);
+    void removePiece(U8 piece, U8 color, U8 square);
     void movePiece(U8 piece, U8 color, U8 from, U8 to); 
     void makeMove(Move &move);
     void undoMove();
     bool move(std::string move);
+    Move parseMove(const std::string& move);
+    Move resolveMove(std::string_view uci);
+    Move moveFromSquares(U8 from, U8 to, int promotion = NO_PIECE);
+    Move parseSan(std::string_view san);
+    bool isLegal(Move move);
+    Move playMove(std::string_view uci, char* san = nullptr, size_t sanSize = 0);
+    size_t writeSan(Move move, char* buffer, size_t size);
+    size_t writeFlags(Move move, char* buffer, size_t size);
 
 
     // Displaying data
@@ -176,44 +429,84 @@ class Chess {
 
     // Initialising and saving
     void init(std::string fen);
+    void loadFen(std::string_view fen);
     void initAttackTables();
     void initMoveTables();
+    void initZobrist();
+    void initEval();
     void saveChanges();
 
+    // Hashing
+    Key computeHash();
+    Key enPassantKey();
+
     // Bitboard manipulation
     void setBit(Bitboard &map, U8 index);
     void unsetBit(Bitboard &map, U8 index);
     int countBits(Bitboard& map);
+    int popLSB(Bitboard& map);
     Bitboard getWithSetBit(int square);
     
 
 
     // Move generation
-    int getPawnMoves(Move* buffer, U8 square);
-    int getBishopMoves(Move* buffer, U8 square);
-    int getKnightMoves(Move* buffer, U8 square);
-    int getRookMoves(Move* buffer, U8 square);
-    int getQueenMoves(Move* buffer, U8 square);
+    int getPawnMoves(Move* buffer, Bitboard pawns, Bitboard targetMask = ~0ULL);
+    int getEnPassantMoves(Move* buffer, bool legalOnly);
+    int addPromotions(Move* buffer, U8 from, U8 to, U8 capture);
+    int getBishopMoves(Move* buffer, U8 square, Bitboard targetMask = ~0ULL);
+    int getKnightMoves(Move* buffer, U8 square, Bitboard targetMask = ~0ULL);
+    int getRookMoves(Move* buffer, U8 square, Bitboard targetMask = ~0ULL);
+    int getQueenMoves(Move* buffer, U8 square, Bitboard targetMask = ~0ULL);
     int getKingMoves(Move* buffer, U8 square);
+    int getCastlingMoves(Move* buffer, U8 square);
     int GenerateMoves(Move* buffer);
-    int GenerateLegalMoves(Move* buffer);
+    int GenerateLegalMoves(Move* buffer, bool capturesOnly = false);
+    int GenerateLegalMoves(MoveList& list, bool capturesOnly = false);
 
 
     // Attack detection
+    void initMagics();
+    void initLineMasks();
     Bitboard rookAttacks(int square, Bitboard occ);
     Bitboard bishopAttacks(int square, Bitboard occ);
 
     // Validation checks
+    bool isSquareAttacked(int square, U8 byColor, Bitboard occ);
+    static bool isValidFen(std::string_view fen);
+    Bitboard attackersTo(int square, Bitboard occ);
+    int see(Move move);
     bool isInCheck(int kingsqr = -1, bool flip = false);
     bool isLegalMove(U8 from, U8 to, int promotionPiece);
     bool isCheckMate();
     bool isStaleMate();
     U8 isGameOver();
+    bool isRepetition(int root);
+    bool isDraw();
 
     // Evaluation
-    Eval negaMax(int depth, int alpha, int beta); 
+    Eval negaMax(int depth, int alpha, int beta, int ply = 0); 
+    Eval quiescence(int alpha, int beta, int ply);
+    void scoreMoves(Move* moves, int* scores, int count, Move ttMove, int ply);
+    Move pickMove(Move* moves, int* scores, int count, int index);
+    void updateQuietStats(Move move, int depth, int ply);
+    void resetOrdering();
+    SearchResult search(const SearchLimits& searchLimits, bool report = true);
+    SearchResult iterativeDeepening(int threadId, bool report);
+    bool checkStop();
+    double elapsedMs();
+    std::string formatScore(int score);
     Eval evaluate();
-    Bitboard perft(int depth, int* mates, int originalDepth = -1);//, int& mates);
+    PawnEntry* probePawns();
+    void evaluatePawns(PawnEntry* entry);
+    static bool loadNetwork(const std::string& path);
+    void refreshAccumulator();
+    void updateAccumulator(U8 piece, U8 color, int addSquare, int subSquare);
+    Eval evaluateNetwork();
+    Bitboard perft(int depth, int* mates, int originalDepth = -1, bool bulk = true);//, int& mates);
+    Bitboard perftNodes(int depth, bool bulk = true);
+    Bitboard hashedPerft(int depth, PerftTable& table, int originalDepth = -1);
+    Bitboard parallelPerft(int depth, int threads, int splitDepth = 1);
+    void collectSplitPoints(int depth, Move* line, int ply, int rootIndex, std::vector<Move>& lines, std::vector<int>& rootIndices);
 
 
     // ------------------------------------------- JS MODULE -------------------------------------------
@@ -225,3 +518,36 @@ class Chess {
 };
 
 
+// ------------------------------------------- PGN -------------------------------------------
+
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::string movetext;
+
+    std::string tag(const std::string& name) const;
+};
+
+// Splits a PGN stream into games one at a time, the moves are left to replayPgn()
+class PgnReader {
+
+    public:
+
+    explicit PgnReader(std::istream& input) : input(input) {}
+    bool next(PgnGame& game);
+
+    private:
+
+    std::istream& input;
+    std::string pending; // First tag line of the next game, read while finishing the current one
+
+};
+
+bool replayPgn(Chess& board, const PgnGame& game, std::vector<Move>& moves, std::string& error);
+void writePgn(std::ostream& out, const Chess& start, const std::vector<std::pair<std::string, std::string>>& tags,
+              const Move* moves, int count, const std::string& result);
+
+
+// Front ends
+void runUCI(size_t hashMegabytes, std::string firstCommand = "");
+int runBatch(const std::string& path, const SearchLimits& limits, int threads, size_t hashMegabytes);
+int runPgnImport(const std::string& path, int threads);
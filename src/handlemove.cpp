@@ -9,45 +9,22 @@ void Chess::makeMove(Move &move) {
 
     U8 color = currentTurn;
 
+    bool isCapture = isCaptureMove(move);
+
+    promotedPiece = getPromotedPiece(move);
+    capturedPiece = (flags == EN_PASSANT_FLAG) ? PAWN : pieceLocations[to] >> 1;
 
-    GameState gs;
+    if (stackPointer == (int)gameStateStack.size()) gameStateStack.resize(stackPointer * 2);
+    GameState& gs = gameStateStack[stackPointer++];
 
-    gs.currentTurn = currentTurn;
+    gs.move = move;
+    gs.capturedPiece = capturedPiece;
     gs.castlingRights = castlingRights;
     gs.enPassantSquare = enPassantSquare;
     gs.fiftyMoveRuleCounter = moveRule50Count;
-    gs.capturedPiece = NO_PIECE;
-    gs.promotedPiece = NO_PIECE;
-
-    gs.kingSquare[0] = kingSquare[0];
-    gs.kingSquare[1] = kingSquare[1];
-
-    gs.bitboards[PAWN][WHITE] = bitboards[PAWN][WHITE];
-    gs.bitboards[BISHOP][WHITE] = bitboards[BISHOP][WHITE];
-    gs.bitboards[KNIGHT][WHITE] = bitboards[KNIGHT][WHITE];
-    gs.bitboards[ROOK][WHITE] = bitboards[ROOK][WHITE];
-    gs.bitboards[QUEEN][WHITE] = bitboards[QUEEN][WHITE];
-    gs.bitboards[KING][WHITE] = bitboards[KING][WHITE];
-
-    gs.bitboards[PAWN][BLACK] = bitboards[PAWN][BLACK];
-    gs.bitboards[BISHOP][BLACK] = bitboards[BISHOP][BLACK];
-    gs.bitboards[KNIGHT][BLACK] = bitboards[KNIGHT][BLACK];
-    gs.bitboards[ROOK][BLACK] = bitboards[ROOK][BLACK];
-    gs.bitboards[QUEEN][BLACK] = bitboards[QUEEN][BLACK];
-    gs.bitboards[KING][BLACK] = bitboards[KING][BLACK];
-
-    gs.whitePieces = whitePieces;
-    gs.blackPieces = blackPieces;
-    gs.allPieces = allPieces;
-
-    gameStateStack[stackPointer] = gs;
-    movesStack[stackPointer] = move;
-    stackPointer++;
+    gs.hashKey = hashKey;
 
-    bool isCapture = isCaptureMove(move);
-
-    promotedPiece = getPromotedPiece(move);
-    capturedPiece = getPieceType(to);
+    hashKey ^= enPassantKey() ^ zobristCastling[castlingRights];
 
     // Handling En Passant
     enPassantSquare = 64;
@@ -71,28 +48,24 @@ void Chess::makeMove(Move &move) {
     
     
     if (promotedPiece != NO_PIECE) { // Handle Promotion
-        unsetBit(bitboards[pieceType][color], from);
-        setBit(bitboards[promotedPiece][color], to);
+        removePiece(pieceType, color, from);
         if (isCapture) {
-            
-            unsetBit(bitboards[capturedPiece][!color], to);
+            removePiece(capturedPiece, !color, to);
         }
+        putPiece(promotedPiece, color, to);
     } else {
-        movePiece(pieceType, color, from, to);
         if (flags == EN_PASSANT_FLAG) {
-            capturedPiece = PAWN;
-            unsetBit(bitboards[capturedPiece][!color], to + (!color ? 8 : -8));
+            removePiece(PAWN, !color, to + (!color ? 8 : -8));
         } else if (isCapture) {
-            unsetBit(bitboards[capturedPiece][!color], to);
+            removePiece(capturedPiece, !color, to);
         } else if (flags == CASTLE_FLAG) {
             if (getFile(to) == KING_SIDE_CASTLE_FILE) {
-                unsetBit(bitboards[ROOK][color], from+3);
-                setBit(bitboards[ROOK][color], from+1);
+                movePiece(ROOK, color, from+3, from+1);
             } else if (getFile(to) == QUEEN_SIDE_CASTLE_FILE) {
-                unsetBit(bitboards[ROOK][color], from-4);
-                setBit(bitboards[ROOK][color], from-1);
+                movePiece(ROOK, color, from-4, from-1);
             }
         }
+        movePiece(pieceType, color, from, to);
     }
 
     if ((pieceType == PAWN) || isCapture) {
@@ -101,45 +74,58 @@ void Chess::makeMove(Move &move) {
         moveRule50Count++;
     }
 
+    if (!currentTurn) fullmoveNumber++;
     currentTurn ^= 1;
+    hashKey ^= zobristSide ^ zobristCastling[castlingRights] ^ enPassantKey();
 
-    saveChanges();
+    if (tt) tt->prefetch(hashKey);
 }
 
 void Chess::undoMove() {
 
     if (stackPointer==0) return;
 
-    stackPointer--;
-    GameState gs = gameStateStack[stackPointer];
+    GameState& gs = gameStateStack[--stackPointer];
+
+    Move move = gs.move;
+    U8 from = getFromSquare(move);
+    U8 to = getToSquare(move);
+    U8 flags = getFlags(move);
+
+    currentTurn ^= 1;
+    U8 color = currentTurn;
+    if (!color) fullmoveNumber--;
+    U8 pieceType = getPieceType(to);
+
+    if (getPromotedPiece(move) != NO_PIECE) {
+        removePiece(pieceType, color, to);
+        if (isCaptureMove(move)) {
+            putPiece(gs.capturedPiece, !color, to);
+        }
+        putPiece(PAWN, color, from);
+    } else {
+        movePiece(pieceType, color, to, from);
+        if (flags == EN_PASSANT_FLAG) {
+            putPiece(PAWN, !color, to + (!color ? 8 : -8));
+        } else if (isCaptureMove(move)) {
+            putPiece(gs.capturedPiece, !color, to);
+        } else if (flags == CASTLE_FLAG) {
+            if (getFile(to) == KING_SIDE_CASTLE_FILE) {
+                movePiece(ROOK, color, from+1, from+3);
+            } else if (getFile(to) == QUEEN_SIDE_CASTLE_FILE) {
+                movePiece(ROOK, color, from-1, from-4);
+            }
+        }
+    }
+
+    if (pieceType == KING) kingSquare[color] = from;
 
-    currentTurn = gs.currentTurn;
     castlingRights = gs.castlingRights;
     enPassantSquare = gs.enPassantSquare;
     moveRule50Count = gs.fiftyMoveRuleCounter;
-    capturedPiece = gs.capturedPiece;
-    promotedPiece = gs.promotedPiece;
-
-    kingSquare[0] = gs.kingSquare[0];
-    kingSquare[1] = gs.kingSquare[1];
-
-    bitboards[PAWN][WHITE] = gs.bitboards[PAWN][WHITE];
-    bitboards[BISHOP][WHITE] = gs.bitboards[BISHOP][WHITE];
-    bitboards[KNIGHT][WHITE] = gs.bitboards[KNIGHT][WHITE];
-    bitboards[ROOK][WHITE] = gs.bitboards[ROOK][WHITE];
-    bitboards[QUEEN][WHITE] = gs.bitboards[QUEEN][WHITE];
-    bitboards[KING][WHITE] = gs.bitboards[KING][WHITE];
-
-    bitboards[PAWN][BLACK] = gs.bitboards[PAWN][BLACK];
-    bitboards[BISHOP][BLACK] = gs.bitboards[BISHOP][BLACK];
-    bitboards[KNIGHT][BLACK] = gs.bitboards[KNIGHT][BLACK];
-    bitboards[ROOK][BLACK] = gs.bitboards[ROOK][BLACK];
-    bitboards[QUEEN][BLACK] = gs.bitboards[QUEEN][BLACK];
-    bitboards[KING][BLACK] = gs.bitboards[KING][BLACK];
-
-    whitePieces = gs.whitePieces;
-    blackPieces = gs.blackPieces;
-    allPieces = gs.allPieces;
+    hashKey = gs.hashKey;
+    capturedPiece = NO_PIECE;
+    promotedPiece = NO_PIECE;
 }
 
 bool Chess::move(std::string move) {
@@ -176,168 +162,166 @@ bool Chess::move(std::string move) {
     return false;
 }
 
-// ------------------------------------------- JS MODULE -------------------------------------------
-
-MoveData Chess::makeMoveJS(Move move) {
-    U8 from = getFromSquare(move);
-    U8 to = getToSquare(move);
-
-    U8 pieceType = getPieceType(from);
-    U8 flags = getFlags(move);
-
-    U8 color = currentTurn;
-
-
-    GameState gs;
-
-    gs.currentTurn = currentTurn;
-    gs.castlingRights = castlingRights;
-    gs.enPassantSquare = enPassantSquare;
-    gs.fiftyMoveRuleCounter = moveRule50Count;
-    gs.capturedPiece = NO_PIECE;
-    gs.promotedPiece = NO_PIECE;
+// Long algebraic notation (e2e4, e7e8q) to a legal move, 0 if there is none
+Move Chess::parseMove(const std::string& move) {
+    return resolveMove(move);
+}
 
-    gs.kingSquare[0] = kingSquare[0];
-    gs.kingSquare[1] = kingSquare[1];
+// Builds the move straight from the board instead of generating every legal move, 0 if illegal
+Move Chess::resolveMove(std::string_view uci) {
+    if (uci.size() < 4 || uci.size() > 5) return 0;
+    if (uci[0] < 'a' || uci[0] > 'h' || uci[1] < '1' || uci[1] > '8') return 0;
+    if (uci[2] < 'a' || uci[2] > 'h' || uci[3] < '1' || uci[3] > '8') return 0;
 
-    memcpy(gs.bitboards, bitboards, sizeof(Bitboard)*12);
+    U8 from = (uci[1] - '1') * 8 + (uci[0] - 'a');
+    U8 to = (uci[3] - '1') * 8 + (uci[2] - 'a');
 
-    gs.whitePieces = whitePieces;
-    gs.blackPieces = blackPieces;
-    gs.allPieces = allPieces;
+    int promotion = NO_PIECE;
+    if (uci.size() == 5) {
+        switch (tolower(uci[4]))
+        {
+        case 'q': promotion = QUEEN; break;
+        case 'r': promotion = ROOK; break;
+        case 'b': promotion = BISHOP; break;
+        case 'n': promotion = KNIGHT; break;
+        default: return 0;
+        }
+    }
 
-    gameStateStack[stackPointer] = gs;
-    movesStack[stackPointer] = move;
-    stackPointer++;
+    return moveFromSquares(from, to, promotion);
+}
 
-    bool isCapture = isCaptureMove(move);
-    std::string flagInstance = "";
+// Encodes the move of the piece on 'from' to 'to', with castling, en passant and the capture
+// bit read from the board. 0 if it is illegal or the promotion piece does not fit.
+Move Chess::moveFromSquares(U8 from, U8 to, int promotion) {
+    if (pieceLocations[from] == EMPTY_SQUARE) return 0;
 
-    promotedPiece = getPromotedPiece(move);
-    capturedPiece = getPieceType(to);
+    U8 piece = pieceLocations[from] >> 1;
+    U8 capture = pieceLocations[to] != EMPTY_SQUARE;
+    U8 flags = NOTHING_FLAG; // Captures are marked by the capture bit alone
 
-    // Handling En Passant
-    enPassantSquare = 64;
-    if ((pieceType == PAWN) && abs(to-from) == 16) {
-        enPassantSquare = to + (currentTurn ? -8 : 8);
+    if (piece == KING && (from > to ? from - to : to - from) == 2) {
+        flags = CASTLE_FLAG;
+    } else if (piece == PAWN && to == enPassantSquare && getFile(from) != getFile(to)) {
+        flags = EN_PASSANT_FLAG;
+        capture = 1;
     }
 
-    // Handling Castling Rights
-    if (pieceType==KING){
-        castlingRights &= ~(1ULL << (currentTurn ? 3 : 1)); // King Side
-        castlingRights &= ~(1ULL << (currentTurn ? 2 : 0)); // Queen Side
-        kingSquare[currentTurn] = to;
-    } else if (pieceType==ROOK) {
-        if (from == (currentTurn ? 0 : 56)) {
-            castlingRights &= ~(1ULL << (currentTurn ? 2 : 0));
-        } else if (from == (currentTurn ? 7 : 63)) {
-            castlingRights &= ~(1ULL << (currentTurn ? 3 : 1));
+    bool promotes = piece == PAWN && (to >= 56 || to < 8);
+    if (promotes != (promotion != NO_PIECE)) return 0;
+    if (promotes) {
+        switch (promotion)
+        {
+        case QUEEN: flags = QUEEN_PROM_FLAG; break;
+        case ROOK: flags = ROOK_PROM_FLAG; break;
+        case BISHOP: flags = BISHOP_PROM_FLAG; break;
+        case KNIGHT: flags = KNIGHT_PROM_FLAG; break;
+        default: return 0;
         }
     }
 
-    
-    
-    if (promotedPiece != NO_PIECE) { // Handle Promotion
-        unsetBit(bitboards[pieceType][color], from);
-        setBit(bitboards[promotedPiece][color], to);
-        if (isCapture) {
-            
-            unsetBit(bitboards[capturedPiece][!color], to);
-        }
-    } else {
-        movePiece(pieceType, color, from, to);
-        if (flags == EN_PASSANT_FLAG) {
-            flagInstance += "e";
-            capturedPiece = PAWN;
-            unsetBit(bitboards[capturedPiece][!color], to + (!color ? 8 : -8));
-        } else if (isCapture) {
-            unsetBit(bitboards[capturedPiece][!color], to);
-        } else if (flags == CASTLE_FLAG) {
-            if (getFile(to) == KING_SIDE_CASTLE_FILE) {
-                flagInstance += "k";
-                unsetBit(bitboards[ROOK][color], from+3);
-                setBit(bitboards[ROOK][color], from+1);
-            } else if (getFile(to) == QUEEN_SIDE_CASTLE_FILE) {
-                flagInstance += "q";
-                unsetBit(bitboards[ROOK][color], from-4);
-                setBit(bitboards[ROOK][color], from-1);
-            }
-        }
-    }
+    Move move = constructMove(from, to, capture, flags);
+    return isLegal(move) ? move : 0;
+}
 
-    if ((pieceType == PAWN) || isCapture) {
-        moveRule50Count=0;
-    } else {
-        moveRule50Count++;
+// Checks any move against the current position: the moving piece, its geometry, the capture
+// bit and finally king safety by playing the move
+bool Chess::isLegal(Move move) {
+    U8 us = currentTurn;
+    U8 from = getFromSquare(move);
+    U8 to = getToSquare(move);
+    U8 flags = getFlags(move);
+    Bitboard toMask = getWithSetBit(to);
+    Bitboard ours = us ? whitePieces : blackPieces;
+    Bitboard theirs = us ? blackPieces : whitePieces;
+
+    U8 code = pieceLocations[from];
+    if (code == EMPTY_SQUARE || (code & 1) != us || from == to) return false;
+    U8 piece = code >> 1;
+
+    if (flags == CASTLE_FLAG) {
+        Move castles[2];
+        int count = piece == KING ? getCastlingMoves(castles, from) : 0;
+        return (count > 0 && castles[0] == move) || (count > 1 && castles[1] == move);
     }
 
-    std::string san;
+    bool promotion = getPromotedPiece(move) != NO_PIECE;
+    if (promotion != (piece == PAWN && (toMask & (RANK_1 | RANK_8)))) return false;
 
-    if(pieceType!=PAWN) san+=notations[pieceType][0];
-    if (isCapture) {
-        if(pieceType==PAWN) {
-            san+=getNotation(from)[0];
+    if (flags == EN_PASSANT_FLAG) {
+        if (piece != PAWN || to != enPassantSquare || !isCaptureMove(move) || !(pawnAttacks[us][from] & toMask)) return false;
+    } else {
+        if ((ours & toMask) || isCaptureMove(move) != bool(theirs & toMask)) return false;
+        if (!promotion && flags != NOTHING_FLAG) return false;
+
+        Bitboard reach = 0;
+        switch (piece)
+        {
+        case PAWN: {
+            int up = us ? 8 : -8;
+            if (isCaptureMove(move)) reach = pawnAttacks[us][from];
+            else if (to == from + up) reach = toMask;
+            else if (to == from + 2 * up && (getRank(from) == (us ? WHITE_PAWN_STARTING_RANK : BLACK_PAWN_STARTING_RANK))
+                     && pieceLocations[from + up] == EMPTY_SQUARE) reach = toMask;
+            break;
         }
-        san+="x";
+        case KNIGHT: reach = knightAttacks[from]; break;
+        case BISHOP: reach = bishopAttacks(from, allPieces); break;
+        case ROOK: reach = rookAttacks(from, allPieces); break;
+        case QUEEN: reach = bishopAttacks(from, allPieces) | rookAttacks(from, allPieces); break;
+        case KING: reach = kingAttacks[from]; break;
+        }
+        if (!(reach & toMask)) return false;
     }
 
-    san+=getNotation(to);
-
-    if (isInCheck()) san+="+";
-
-    if (getFlags(move) == KING_SIDE_CASTLE_FILE) {
-        san = "O-O";
-    } else if (getFlags(move) == QUEEN_SIDE_CASTLE_FILE) {
-        san = "O-O-O";
-    }
+    makeMove(move);
+    bool legal = !isSquareAttacked(kingSquare[us], !us, allPieces);
+    undoMove();
 
-    MoveData data = {1, san, (currentTurn ? "w" : "b"), flagInstance};
+    return legal;
+}
 
-    currentTurn ^= 1;
+// Resolves and plays a UCI move, optionally writing its SAN first. Returns 0 if illegal.
+Move Chess::playMove(std::string_view uci, char* san, size_t sanSize) {
+    Move move = resolveMove(uci);
+    if (!move) return 0;
 
-    saveChanges();
+    if (san) writeSan(move, san, sanSize);
+    makeMove(move);
+    return move;
+}
 
-    return data;
-    
+// The front end's move flags: 'e' en passant, 'k'/'q' castling side, empty otherwise
+size_t Chess::writeFlags(Move move, char* buffer, size_t size) {
+    char flag = '\0';
+    if (getFlags(move) == EN_PASSANT_FLAG) flag = 'e';
+    else if (getFlags(move) == CASTLE_FLAG) flag = getFile(getToSquare(move)) == KING_SIDE_CASTLE_FILE ? 'k' : 'q';
+
+    if (size > 1) {
+        buffer[0] = flag;
+        buffer[flag ? 1 : 0] = '\0';
+    } else if (size) {
+        buffer[0] = '\0';
+    }
+    return flag ? 1 : 0;
 }
 
-MoveData Chess::moveJS(std::string move) {
+// ------------------------------------------- JS MODULE -------------------------------------------
 
-    U8 from = squareFromNotation(move.substr(0, 2));
-    U8 to = squareFromNotation(move.substr(2, 2));
+MoveData Chess::makeMoveJS(Move move) {
+    char san[16], flags[2];
+    writeSan(move, san, sizeof(san));
+    writeFlags(move, flags, sizeof(flags));
 
-    int promotionPiece = NO_PIECE;
-    if (move.length() == 5) {
-        switch (move[4])
-        {
-        case 'Q':
-            promotionPiece = QUEEN;
-            break;
-        case 'R':
-            promotionPiece = ROOK;
-            break;
-        case 'N':
-            promotionPiece = KNIGHT;
-            break;
-        case 'B':
-            promotionPiece = BISHOP;
-            break;
-        
-        default:
-            break;
-        }
-    }
+    std::string color = currentTurn ? "w" : "b";
+    makeMove(move);
 
+    return {1, san, color, flags};
+}
 
-    std::vector<Move> Moves = GenerateLegalMovesJS();
-    MoveData data;
+MoveData Chess::moveJS(std::string move) {
+    Move resolved = resolveMove(move);
+    if (!resolved) return {0, "", "", ""};
 
-    for (Move move : Moves) {
-        if (from == getFromSquare(move) && to == getToSquare(move) && promotionPiece == getPromotedPiece(move)) {
-            data = makeMoveJS(move);
-            return data;
-        }
-    }
-    data = {0, "", "", ""};
-    return data;
-}
\ No newline at end of file
+    return makeMoveJS(resolved);
+}
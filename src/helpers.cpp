@@ -47,19 +47,10 @@ U8 Chess::getFile(U8 square) {
     return (char)(square%8);
 }
 U8 Chess::getPieceColor(U8 square) {
-    return ((1ULL << square) & whitePieces) ? 1 : 0;
+    return pieceLocations[square] & 1;
 }
 U8 Chess::getPieceType(int square) {
-    Bitboard mask = (1ULL << square);
-
-    if ((bitboards[PAWN][WHITE]   & mask) || (bitboards[PAWN][BLACK]   & mask)) return PAWN;
-    if ((bitboards[KNIGHT][WHITE] & mask) || (bitboards[KNIGHT][BLACK] & mask)) return KNIGHT;
-    if ((bitboards[BISHOP][WHITE] & mask) || (bitboards[BISHOP][BLACK] & mask)) return BISHOP;
-    if ((bitboards[ROOK][WHITE]   & mask) || (bitboards[ROOK][BLACK]   & mask)) return ROOK;
-    if ((bitboards[QUEEN][WHITE]  & mask) || (bitboards[QUEEN][BLACK]  & mask)) return QUEEN;
-    if ((bitboards[KING][WHITE]   & mask) || (bitboards[KING][BLACK]   & mask)) return KING;
-
-    return NO_PIECE;
+    return pieceLocations[square] >> 1;
 }
 bool Chess::inPromoPosition(int square) {
     return getRank(square) == (currentTurn ? WHITE_PROMOTION_RANK : BLACK_PROMOTION_RANK);
@@ -92,75 +83,101 @@ std::string Chess::getPromotionNotation(Move& move) {
     }
 }
 std::string Chess::getFen() {
-    std::string fen = "";
-
-    int emptySquares = 0;
-    int square = 56;
-    while (true) {
+    char fen[128];
+    writeFen(fen, sizeof(fen));
+    return fen;
+}
 
-        
-        if (getPieceType(square) == NO_PIECE) {
-            emptySquares++;
-        } else {
-            char current = notations[getPieceType(square)][!getPieceColor(square)];
-            if (emptySquares > 0) {
-                fen += std::to_string(emptySquares);
-                emptySquares=0;
+// Writes the FEN without allocating, returns the length it needs (snprintf style)
+size_t Chess::writeFen(char* buffer, size_t size) {
+    char fen[128];
+    size_t length = 0;
+
+    for (int rank = 7; rank >= 0; rank--) {
+        int emptySquares = 0;
+        for (int file = 0; file < 8; file++) {
+            U8 code = pieceLocations[rank * 8 + file];
+            if (code == EMPTY_SQUARE) {
+                emptySquares++;
+                continue;
             }
-            fen += std::string(1, current);
+            if (emptySquares) fen[length++] = '0' + emptySquares;
+            emptySquares = 0;
+            fen[length++] = notations[code >> 1][!(code & 1)];
         }
-        
-        if (square == 7) {
-            if (emptySquares > 0) {
-                fen += std::to_string(emptySquares);
-            }
-            break;
-        };
-        square++;
-        if (!(square%8)){
-            if (emptySquares > 0) {
-                fen += std::to_string(emptySquares);
-                emptySquares=0;
-            }
-            fen += "/";
-            square-=16;
-        } 
-
+        if (emptySquares) fen[length++] = '0' + emptySquares;
+        if (rank) fen[length++] = '/';
     }
-    fen += currentTurn ? " w " : " b ";
-    if (castlingRights & 0b1000) {
-        fen += "K";
-    } 
-    if (castlingRights & 0b0100) {
-        fen += "Q";
-    } 
-    if (castlingRights & 0b0010) {
-        fen += "k";
-    } 
-    if (castlingRights & 0b0001) {
-        fen += "q";
-    } 
-
-    fen += " ";
+
+    fen[length++] = ' ';
+    fen[length++] = currentTurn ? 'w' : 'b';
+    fen[length++] = ' ';
+
+    if (castlingRights & 0b1000) fen[length++] = 'K';
+    if (castlingRights & 0b0100) fen[length++] = 'Q';
+    if (castlingRights & 0b0010) fen[length++] = 'k';
+    if (castlingRights & 0b0001) fen[length++] = 'q';
+    if (!castlingRights) fen[length++] = '-';
+    fen[length++] = ' ';
 
     if (enPassantSquare == 64) {
-        fen += "- ";
+        fen[length++] = '-';
     } else {
-        fen += std::string(1, getFile(enPassantSquare) + 'a') + std::string(1, getRank(enPassantSquare) + '1') + " ";
+        fen[length++] = getFile(enPassantSquare) + 'a';
+        fen[length++] = getRank(enPassantSquare) + '1';
     }
 
-    fen += std::to_string(moveRule50Count);
+    length += snprintf(fen + length, sizeof(fen) - length, " %d %d", moveRule50Count, fullmoveNumber);
 
-
-
-    return fen;
+    if (size) {
+        size_t copied = std::min(length, size - 1);
+        memcpy(buffer, fen, copied);
+        buffer[copied] = '\0';
+    }
+    return length;
 }
 
 Move Chess::constructMove(U8 from, U8 to, U8 capture, U8 flags) {
     return (from | (to << TO_SHIFT) | (capture << CAPTURE_SHIFT) | (flags << FLAG_SHIFT));
 }
+void Chess::putPiece(U8 piece, U8 color, U8 square) {
+    Bitboard mask = getWithSetBit(square);
+    bitboards[piece][color] ^= mask;
+    (color ? whitePieces : blackPieces) ^= mask;
+    allPieces ^= mask;
+    pieceLocations[square] = (piece << 1) | color;
+    hashKey ^= zobristPieces[piece][color][square];
+    mgScore += mgTable[piece][color][square];
+    egScore += egTable[piece][color][square];
+    phase += phaseWeights[piece];
+    if (piece == PAWN) pawnKey ^= zobristPieces[PAWN][color][square];
+    if (network) updateAccumulator(piece, color, square, -1);
+}
+void Chess::removePiece(U8 piece, U8 color, U8 square) {
+    Bitboard mask = getWithSetBit(square);
+    bitboards[piece][color] ^= mask;
+    (color ? whitePieces : blackPieces) ^= mask;
+    allPieces ^= mask;
+    pieceLocations[square] = EMPTY_SQUARE;
+    hashKey ^= zobristPieces[piece][color][square];
+    mgScore -= mgTable[piece][color][square];
+    egScore -= egTable[piece][color][square];
+    phase -= phaseWeights[piece];
+    if (piece == PAWN) pawnKey ^= zobristPieces[PAWN][color][square];
+    if (network) updateAccumulator(piece, color, -1, square);
+}
 void Chess::movePiece(U8 piece, U8 color, U8 from, U8 to) {
-    unsetBit(bitboards[piece][color], from); setBit(bitboards[piece][color], to);
+    Bitboard mask = getWithSetBit(from) | getWithSetBit(to);
+    bitboards[piece][color] ^= mask;
+    (color ? whitePieces : blackPieces) ^= mask;
+    allPieces ^= mask;
+    pieceLocations[to] = pieceLocations[from];
+    pieceLocations[from] = EMPTY_SQUARE;
+    hashKey ^= zobristPieces[piece][color][from] ^ zobristPieces[piece][color][to];
+    mgScore += mgTable[piece][color][to] - mgTable[piece][color][from];
+    egScore += egTable[piece][color][to] - egTable[piece][color][from];
+    if (piece == PAWN) pawnKey ^= zobristPieces[PAWN][color][from] ^ zobristPieces[PAWN][color][to];
+    if (network) updateAccumulator(piece, color, to, from);
 }
 
 void Chess::displayBitMap(Bitboard map) {
@@ -185,12 +202,11 @@ void Chess::displayBoard() {
             square-=16;
             std::cout<<"\n";
         }
-        U8 piece = getPieceType(square);
-        if (piece == NO_PIECE) {
+        U8 code = pieceLocations[square];
+        if (code == EMPTY_SQUARE) {
             std::cout << ". ";
         } else {
-            int color = getPieceColor(square); // 0 = WHITE, 1 = BLACK
-            std::cout << notations[piece][!color] << " ";
+            std::cout << notations[code >> 1][!(code & 1)] << " ";
         }
         square++;
     }
@@ -204,11 +220,25 @@ void Chess::displayMoves(std::vector<Move> moves) {
 }
 
 void Chess::init(std::string fen) {
+    initMoveTables();
+    initAttackTables();
+    initZobrist();
+    initEval();
+
+    loadFen(fen);
+}
+void Chess::loadFen(std::string_view fen) {
     // Bottom left corner is LSB, Top right corner is MSB
     U8 square = 56; // starting at a8 moving right
-    U8 index = 0;
+    size_t index = 0;
     U8 inc = 0;
     
+    memset(bitboards, 0, sizeof(bitboards));
+    memset(pieceLocations, EMPTY_SQUARE, sizeof(pieceLocations));
+    castlingRights = 0;
+    stackPointer = 0;
+    mgScore = egScore = phase = 0;
+    pawnKey = 0;
     
     for (char value : fen) {
         index++;
@@ -224,47 +254,47 @@ void Chess::init(std::string fen) {
             switch (value)
             {
             case 'P':
-                setBit(bitboards[PAWN][WHITE], square);
+                putPiece(PAWN, WHITE, square);
                 break;
             case 'p':
-                setBit(bitboards[PAWN][BLACK], square);
+                putPiece(PAWN, BLACK, square);
                 break;
 
             case 'N':
-                setBit(bitboards[KNIGHT][WHITE], square);
+                putPiece(KNIGHT, WHITE, square);
                 break;
             case 'n':
-                setBit(bitboards[KNIGHT][BLACK], square);
+                putPiece(KNIGHT, BLACK, square);
                 break;
 
             case 'B':
-                setBit(bitboards[BISHOP][WHITE], square);
+                putPiece(BISHOP, WHITE, square);
                 break;
             case 'b':
-                setBit(bitboards[BISHOP][BLACK], square);
+                putPiece(BISHOP, BLACK, square);
                 break;
 
             case 'R':
-                setBit(bitboards[ROOK][WHITE], square);
+                putPiece(ROOK, WHITE, square);
                 break;
 
             case 'r':
-                setBit(bitboards[ROOK][BLACK], square);
+                putPiece(ROOK, BLACK, square);
                 break;
             
             case 'Q':
-                setBit(bitboards[QUEEN][WHITE], square);
+                putPiece(QUEEN, WHITE, square);
                 break;
             case 'q':
-                setBit(bitboards[QUEEN][BLACK], square);
+                putPiece(QUEEN, BLACK, square);
                 break;
             
             case 'K':
-                setBit(bitboards[KING][WHITE], square);
+                putPiece(KING, WHITE, square);
                 kingSquare[1] = square;
                 break;
             case 'k':
-                setBit(bitboards[KING][BLACK], square);
+                putPiece(KING, BLACK, square);
                 kingSquare[0] = square;
                 break;
             
@@ -276,11 +306,11 @@ void Chess::init(std::string fen) {
         }
     }
 
-    currentTurn = (fen[index] == 'w' ? 1 : 0);
+    currentTurn = (index < fen.size() && fen[index] == 'w' ? 1 : 0);
 
     index +=2;
     
-    while (fen[index] != ' ') {
+    while (index < fen.size() && fen[index] != ' ') {
         // Set castling rights
         switch (fen[index])
         {
@@ -307,22 +337,32 @@ void Chess::init(std::string fen) {
 
     index++;
 
-    if (fen[index] == '-')  {
+    if (index + 1 >= fen.size() || fen[index] == '-')  {
         enPassantSquare = 64;
     } else {
         enPassantSquare = (fen[index+1] - '1') * 8 + (fen[index] - 'a');
     }
 
-    index+=2;
+    while (index < fen.size() && fen[index] != ' ') index++;
+
+    while (index < fen.size() && fen[index] == ' ') index++;
+
+    moveRule50Count = 0;
+    while (index < fen.size() && isdigit(fen[index])) moveRule50Count = moveRule50Count * 10 + (fen[index++] - '0');
+
+    while (index < fen.size() && fen[index] == ' ') index++;
 
-    moveRule50Count = (fen[index] - '0');
+    fullmoveNumber = 0;
+    while (index < fen.size() && isdigit(fen[index])) fullmoveNumber = fullmoveNumber * 10 + (fen[index++] - '0');
+    fullmoveNumber = std::max(fullmoveNumber, 1);
     
     // std::cout << "Finished Parsing Fen" << "\n";
     // std::cout << "En Passant Square = " << (int)enPassantSquare << "\n\n";
 
     saveChanges(); 
-    initMoveTables();
-    initAttackTables();
+
+    hashKey = computeHash();
+    refreshAccumulator();
 }
 void Chess::saveChanges() {
     whitePieces = 0;
@@ -344,6 +384,11 @@ void Chess::unsetBit(Bitboard &map, U8 index) {
 int Chess::countBits(Bitboard& map) {
     return __builtin_popcountll(map);
 }
+int Chess::popLSB(Bitboard& map) {
+    int square = __builtin_ctzll(map);
+    map &= map - 1;
+    return square;
+}
 Bitboard Chess::getWithSetBit(int square) {
     return (1ULL << square);
 }
@@ -2,6 +2,10 @@
 #include <iostream>
 #include <cctype>
 #include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <fstream>
+#include <sstream>
 
 void print(auto value, int breakln = 1, bool padding = 0) {
     std::cout << value << (breakln ? "\n" : "");
@@ -18,21 +22,122 @@ void displayWelcomeMessage() {
     print("[5]     Enter 'undo' to undo a previously made move.");
     print("[6]     Enter 'board' to display the current board.");
     print("[7]     Enter 'evaluate' followed by a depth value to calculate the evaluation of a given position.");
-    print("[8]     Enter 'perft' followed by a depth value to run a timed performance test.");
+    print("[8]     Enter 'perft' followed by a depth value to run a timed performance test ('full' after the depth disables bulk counting).");
     print("[9]     Enter 'over' to check if checkmate has occured.");
     print("[10]    Enter 'fen' to display the current fen.");
-    print("[11]    Enter 'quit' to quit the program.", 1, 1);
+    print("[11]    Enter 'hash' to display the Zobrist key of the current position.");
+    print("[12]    Enter 'hperft' followed by a depth value to run perft with cached subtree counts.");
+    print("[13]    Enter 'pperft' followed by a depth and optional split depth to run perft on all threads.");
+    print("[14]    Enter 'search' followed by any of 'depth N', 'time MS', 'nodes N' to run a bounded iterative deepening search.");
+    print("[15]    Enter 'uci' to switch to the UCI protocol.");
+    print("[16]    Enter 'pgn' to display the moves played so far as PGN.");
+    print("[17]    Enter 'quit' to quit the program.", 1, 1);
 
 }
 
-void runInterface() {
+// Runs every "FEN ;D<depth> <nodes> ..." line of an EPD file, returns the process exit status.
+// "FEN ;invalid" lines must be rejected by Chess::isValidFen instead.
+int runPerftSuite(const std::string& path, int maxDepth) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open " << path << std::endl;
+        return 2;
+    }
+
+    using std::chrono::high_resolution_clock;
+    using std::chrono::duration;
+
+    int positions = 0, failures = 0;
+    uint64_t totalNodes = 0;
+    double totalMs = 0;
+
+    std::string line;
+    while (getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        std::stringstream fields(line);
+        std::string fen;
+        getline(fields, fen, ';');
+        fen.erase(fen.find_last_not_of(" \t") + 1);
+
+        // EPD positions may omit the move counters
+        if (std::count(fen.begin(), fen.end(), ' ') == 3) fen += " 0 1";
+
+        positions++;
+        print("#", 0);
+        print(positions, 0);
+        print(" ", 0);
+        print(fen);
+
+        bool expectInvalid = line.find(";invalid") != std::string::npos;
+        if (expectInvalid || !Chess::isValidFen(fen)) {
+            bool ok = expectInvalid && !Chess::isValidFen(fen);
+            if (!ok) failures++;
+            print(ok ? "  rejected ok" : (expectInvalid ? "  accepted FAIL" : "  rejected FAIL"));
+            continue;
+        }
+
+        Chess* Board = new Chess();
+        Board->init(fen);
+
+        std::string expectation;
+        while (getline(fields, expectation, ';')) {
+            int depth;
+            uint64_t expected;
+            if (sscanf(expectation.c_str(), " D%d %llu", &depth, (unsigned long long*)&expected) != 2) continue;
+            if (maxDepth > 0 && depth > maxDepth) continue;
+
+            auto t1 = high_resolution_clock::now();
+            uint64_t nodes = Board->perftNodes(depth);
+            auto t2 = high_resolution_clock::now();
+            double ms = duration<double, std::milli>(t2 - t1).count();
+
+            totalNodes += nodes;
+            totalMs += ms;
+
+            bool ok = nodes == expected;
+            if (!ok) failures++;
+
+            char report[160];
+            snprintf(report, sizeof(report), "  D%-2d %12llu %s %10.1fms %8.2f Mnps", depth, (unsigned long long)nodes,
+                     ok ? "ok  " : "FAIL", ms, ms > 0 ? nodes / ms / 1000.0 : 0.0);
+            print(report, 0);
+            if (!ok) {
+                print(" (expected ", 0);
+                print(expected, 0);
+                print(")", 0);
+            }
+            print("");
+        }
+
+        delete Board;
+    }
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "%d positions, %d failures, %llu nodes in %.1fms, %.2f Mnps", positions, failures,
+             (unsigned long long)totalNodes, totalMs, totalMs > 0 ? totalNodes / totalMs / 1000.0 : 0.0);
+    print(summary);
+
+    return failures ? 1 : 0;
+}
+
+void runInterface(size_t hashMegabytes, size_t perftHashMegabytes, int threads) {
     std::string initFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
     bool initialised = false;
 
     displayWelcomeMessage();
 
+    TranspositionTable table;
+    table.resize(hashMegabytes);
+
+    PerftTable perftTable;
+    perftTable.resize(perftHashMegabytes);
+
     //Chess Board;
     Chess* Board = new Chess();
+    Board->tt = &table;
+    Board->threads = threads;
 
     std::string input = "";
     while (true) {
@@ -41,6 +146,11 @@ void runInterface() {
 
         if (input == "quit" || input == "-1") break;
 
+        if (input == "uci") {
+            runUCI(hashMegabytes, input);
+            break;
+        }
+
         if (input=="1" || input == "init") {
             if (initialised) {
                 print("Board is already initialised.", 1, 1);
@@ -69,6 +179,9 @@ void runInterface() {
         } else if (input == "3" || input == "clear") {
             delete Board;
             Board = new Chess();
+            Board->tt = &table;
+            Board->threads = threads;
+            table.clear();
             initialised = false;
         } else if ((input.size() == 9 || input.size() == 10) && input.substr(0, 5) == "move ") {
             
@@ -116,7 +229,12 @@ void runInterface() {
                 print("You entered evaluate depth: ", 0);
                 print(depth);
 
-                print(Board->negaMax(depth, -INF, INF) * (Board->currentTurn ? -1 : 1));
+                SearchResult result = Board->search(SearchLimits{depth}, false);
+                print(result.score * (Board->currentTurn ? 1 : -1));
+                if (result.bestMove) {
+                    print("Best move: ", 0);
+                    print(Board->notationFromSquare(result.bestMove), 1, 1);
+                }
 
             } else {
                 print("Invalid depth. Please provide a number after 'evaluate '.", 1, 1);
@@ -129,6 +247,8 @@ void runInterface() {
                 continue;
             }
             std::string depthStr = input.substr(6);
+            bool full = depthStr.size() > 5 && depthStr.substr(depthStr.size() - 5) == " full";
+            if (full) depthStr = depthStr.substr(0, depthStr.size() - 5);
 
             bool valid = !depthStr.empty() && std::all_of(depthStr.begin(), depthStr.end(), ::isdigit);
             if (valid) {
@@ -143,7 +263,7 @@ void runInterface() {
 
                 int mates = 0;
                 auto t1 = high_resolution_clock::now();
-                print(Board->perft(depth, &mates));
+                print(Board->perft(depth, &mates, -1, !full));
                 auto t2 = high_resolution_clock::now();
                 duration<double, std::milli> ms_double = t2 - t1;
                 print(ms_double.count(), 0);
@@ -153,6 +273,91 @@ void runInterface() {
             } else {
                 print("Invalid depth. Please provide a number after 'perft '.", 1, 1);
             }
+        } else if (input.substr(0, 7) == "hperft ") {
+            if (!initialised) {
+                print("Please initialise the board first.", 1, 1);
+                continue;
+            }
+            std::string depthStr = input.substr(7);
+
+            bool valid = !depthStr.empty() && std::all_of(depthStr.begin(), depthStr.end(), ::isdigit);
+            if (valid) {
+                int depth = std::stoi(depthStr);
+                print("You entered hashed perft depth: ", 0);
+                print(depth);
+
+                using std::chrono::high_resolution_clock;
+                using std::chrono::duration;
+
+                auto t1 = high_resolution_clock::now();
+                print(Board->hashedPerft(depth, perftTable));
+                auto t2 = high_resolution_clock::now();
+                duration<double, std::milli> ms_double = t2 - t1;
+                print(ms_double.count(), 0);
+                print("ms", 1, 1);
+            } else {
+                print("Invalid depth. Please provide a number after 'hperft '.", 1, 1);
+            }
+        } else if (input.substr(0, 7) == "pperft ") {
+            if (!initialised) {
+                print("Please initialise the board first.", 1, 1);
+                continue;
+            }
+            std::string args = input.substr(7);
+            std::string depthStr = args.substr(0, args.find(' '));
+            std::string splitStr = args.find(' ') == std::string::npos ? "1" : args.substr(args.find(' ') + 1);
+
+            bool valid = !depthStr.empty() && std::all_of(depthStr.begin(), depthStr.end(), ::isdigit) &&
+                         !splitStr.empty() && std::all_of(splitStr.begin(), splitStr.end(), ::isdigit);
+            if (valid) {
+                int depth = std::stoi(depthStr);
+                int splitDepth = std::stoi(splitStr);
+                print("You entered parallel perft depth: ", 0);
+                print(depth, 0);
+                print(" on ", 0);
+                print(threads, 0);
+                print(" threads");
+
+                using std::chrono::high_resolution_clock;
+                using std::chrono::duration;
+
+                auto t1 = high_resolution_clock::now();
+                print(Board->parallelPerft(depth, threads, splitDepth));
+                auto t2 = high_resolution_clock::now();
+                duration<double, std::milli> ms_double = t2 - t1;
+                print(ms_double.count(), 0);
+                print("ms", 1, 1);
+            } else {
+                print("Invalid depth. Please provide a number after 'pperft ', optionally followed by a split depth.", 1, 1);
+            }
+        } else if (input == "search" || input.substr(0, 7) == "search ") {
+            if (!initialised) {
+                print("Please initialise the board first.", 1, 1);
+                continue;
+            }
+            SearchLimits limits;
+            std::stringstream args(input.substr(6));
+            std::string name, value;
+            bool valid = true;
+            while (args >> name) {
+                if (!(args >> value) || !std::all_of(value.begin(), value.end(), ::isdigit)) {
+                    valid = false;
+                    break;
+                }
+                if (name == "depth") limits.depth = std::stoi(value);
+                else if (name == "time") limits.movetime = std::stoll(value);
+                else if (name == "nodes") limits.nodes = std::stoull(value);
+                else valid = false;
+            }
+            if (!valid) {
+                print("Invalid limits. Use any of 'depth N', 'time MS', 'nodes N'.", 1, 1);
+                continue;
+            }
+
+            SearchResult result = Board->search(limits);
+            print("Best move: ", 0);
+            print(Board->notationFromSquare(result.bestMove), 1, 1);
+
         } else if (input == "board" || input == "6") {
             if (!initialised) {
                 print("Please initialise the board first.", 1, 1);
@@ -167,6 +372,10 @@ void runInterface() {
                 continue;
             }
             U8 isOver = Board->isGameOver();
+            if (isOver == Board->REPETITION || isOver == Board->FIFTY_MOVES) {
+                print(isOver == Board->REPETITION ? "Draw by threefold repetition!" : "Draw by the fifty-move rule!", 1, 1);
+                continue;
+            }
             if (isOver > Board->NOT_OVER) {
                 print(isOver==1 ? "Check Mate" : "Stale Mate", 0);
                 print(" for ", 0);
@@ -182,13 +391,105 @@ void runInterface() {
             std::string fen = Board->getFen();
             print(fen, 1, 1);
 
+        } else if (input == "pgn" || input == "16") {
+            if (!initialised) {
+                print("Please initialise the board first.", 1, 1);
+                continue;
+            }
+            std::vector<Move> moves;
+            for (int i = 0; i < Board->stackPointer; i++) moves.push_back(Board->gameStateStack[i].move);
+
+            Chess* start = new Chess(*Board);
+            while (start->stackPointer) start->undoMove();
+
+            U8 isOver = Board->isGameOver();
+            std::string result = isOver == Board->CHECK_MATE ? (Board->currentTurn ? "0-1" : "1-0") : isOver != Board->NOT_OVER ? "1/2-1/2" : "*";
+            writePgn(std::cout, *start, {{"Event", "?"}, {"Site", "?"}, {"Date", "????.??.??"}, {"Round", "?"},
+                                         {"White", "?"}, {"Black", "?"}, {"Result", result}}, moves.data(), moves.size(), result);
+            delete start;
+
+        } else if (input == "hash" || input == "11") {
+            if (!initialised) {
+                print("Please initialise the board first.", 1, 1);
+                continue;
+            }
+            char key[17];
+            snprintf(key, sizeof(key), "%016llx", (unsigned long long)Board->hashKey);
+            print(key, 1, 1);
+
         } else {
             print("Please enter a valid input.", 1, 1);
         }
     }
 }
 
-int main() {
-    runInterface();
+int main(int argc, char** argv) {
+    size_t hashMegabytes = 16;
+    size_t perftHashMegabytes = 16;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string perftSuite = "";
+    int maxDepth = 0;
+    bool uci = false;
+    std::string networkPath = "";
+    std::string batchPath = "";
+    std::string pgnPath = "";
+    SearchLimits batchLimits;
+    bool batchLimited = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--hash" && i + 1 < argc) {
+            hashMegabytes = std::stoul(argv[++i]);
+        } else if (arg == "--perft-hash" && i + 1 < argc) {
+            perftHashMegabytes = std::stoul(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--perft-suite" && i + 1 < argc) {
+            perftSuite = argv[++i];
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            maxDepth = std::stoi(argv[++i]);
+        } else if (arg == "--nnue" && i + 1 < argc) {
+            networkPath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--pgn" && i + 1 < argc) {
+            pgnPath = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            batchLimits.depth = std::stoi(argv[++i]);
+            batchLimited = true;
+        } else if (arg == "--nodes" && i + 1 < argc) {
+            batchLimits.nodes = std::stoull(argv[++i]);
+            batchLimited = true;
+        } else if (arg == "--movetime" && i + 1 < argc) {
+            batchLimits.movetime = std::stoll(argv[++i]);
+            batchLimited = true;
+        } else if (arg == "--uci") {
+            uci = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--hash <MB>] [--perft-hash <MB>] [--threads <N>] [--nnue <file>]"
+                      << " [--perft-suite <file.epd> [--max-depth <N>]]"
+                      << " [--batch <file|-> [--depth <N>] [--nodes <N>] [--movetime <MS>]] [--pgn <file|->] [--uci]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!networkPath.empty() && !Chess::loadNetwork(networkPath)) {
+        std::cerr << "Could not load network " << networkPath << std::endl;
+        return 1;
+    }
+
+    if (!perftSuite.empty()) return runPerftSuite(perftSuite, maxDepth);
+    if (!pgnPath.empty()) return runPgnImport(pgnPath, threads);
+    if (!batchPath.empty()) {
+        // Without any limit a batch would never finish
+        if (!batchLimited) batchLimits.depth = 8;
+        return runBatch(batchPath, batchLimits, threads, hashMegabytes);
+    }
+    if (uci) {
+        runUCI(hashMegabytes);
+        return 0;
+    }
+
+    runInterface(hashMegabytes, perftHashMegabytes, threads);
     return 0;
 }
\ No newline at end of file
@@ -31,179 +31,160 @@ void Chess::initMoveTables() {
     }
 }
 
-int Chess::getPawnMoves(Move* buffer, U8 square) {
+int Chess::addPromotions(Move* buffer, U8 from, U8 to, U8 capture) {
+    buffer[0] = constructMove(from, to, capture, QUEEN_PROM_FLAG);
+    buffer[1] = constructMove(from, to, capture, ROOK_PROM_FLAG);
+    buffer[2] = constructMove(from, to, capture, BISHOP_PROM_FLAG);
+    buffer[3] = constructMove(from, to, capture, KNIGHT_PROM_FLAG);
+    return 4;
+}
+
+int Chess::getPawnMoves(Move* buffer, Bitboard pawns, Bitboard targetMask) {
     int count = 0;
     U8 isWhite = currentTurn;
-    U8 multiplier = isWhite ? 1 : -1;
-    U8 target;
-
-    if (inPromoPosition(square)){
-
-        // Promo captures
-        target = square+9*multiplier;
-        if ((getWithSetBit(target) & (isWhite ? blackPieces : whitePieces))) {
-            buffer[count++] = constructMove(square, target, 1, QUEEN_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, ROOK_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, BISHOP_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, KNIGHT_PROM_FLAG);
-        }
-        target = square+7*multiplier;
-        if ((getWithSetBit(target) & (isWhite ? blackPieces : whitePieces))) {
-            buffer[count++] = constructMove(square, target, 1, QUEEN_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, ROOK_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, BISHOP_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 1, KNIGHT_PROM_FLAG);
-        }
-        
-        
-        target = square+8*multiplier;
-        if (!(getWithSetBit(target) & allPieces)) { // Non-capture promotion
-            buffer[count++] = constructMove(square, target, 0, QUEEN_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 0, ROOK_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 0, BISHOP_PROM_FLAG);
-            buffer[count++] = constructMove(square, target, 0, KNIGHT_PROM_FLAG);
-        }
-
-    } else {
 
-        // Pawn captures
-        target = square+9*multiplier;
-        if ((getWithSetBit(target) & (isWhite ? blackPieces : whitePieces) & pawnMoves[currentTurn][square])) {
-            buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-        }
-        target = square+7*multiplier;
-        if ((getWithSetBit(target) & (isWhite ? blackPieces : whitePieces) & pawnMoves[currentTurn][square])) {
-            buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-        }
+    Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
+    Bitboard empty = ~allPieces;
+    Bitboard promotionRank = isWhite ? RANK_8 : RANK_1;
+
+    // Whole-board shifts, offsets are relative to the pawn's square
+    int up = isWhite ? 8 : -8;
+    int upWest = isWhite ? 7 : -9;
+    int upEast = isWhite ? 9 : -7;
+
+    Bitboard singlePushes = (isWhite ? pawns << 8 : pawns >> 8) & empty;
+    Bitboard doublePushes = (isWhite ? singlePushes << 8 : singlePushes >> 8) & empty & (isWhite ? RANK_4 : RANK_5) & targetMask;
+    Bitboard westCaptures = (isWhite ? pawns << 7 : pawns >> 9) & notHFile & occupiedByThem & targetMask;
+    Bitboard eastCaptures = (isWhite ? pawns << 9 : pawns >> 7) & notAFile & occupiedByThem & targetMask;
+    singlePushes &= targetMask;
+
+    // Promotions
+    Bitboard targets = westCaptures & promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        count += addPromotions(buffer+count, to - upWest, to, 1);
+    }
+    targets = eastCaptures & promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        count += addPromotions(buffer+count, to - upEast, to, 1);
+    }
+    targets = singlePushes & promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        count += addPromotions(buffer+count, to - up, to, 0);
+    }
 
-        // Forward pawn moves
-        target = square+8*multiplier;
-        if (!(getWithSetBit(target) & allPieces)) {// This means one square move is free
-            buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
-            if (inStartingPos(square)) { // This means the pawn is in initial position
-                target = square+16*multiplier;
-                if (!(getWithSetBit(target) & allPieces)) {// This means double square move is free
-                    buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
-                }
+    // Pawn captures
+    targets = westCaptures & ~promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        buffer[count++] = constructMove(to - upWest, to, 1, NOTHING_FLAG);
+    }
+    targets = eastCaptures & ~promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        buffer[count++] = constructMove(to - upEast, to, 1, NOTHING_FLAG);
+    }
 
-            }
+    // Forward pawn moves
+    targets = singlePushes & ~promotionRank;
+    while (targets) {
+        U8 to = popLSB(targets);
+        buffer[count++] = constructMove(to - up, to, 0, NOTHING_FLAG);
     }
-    // En-passant
-    target = enPassantSquare;
-    if ((getRank(square) == (isWhite ? 4 : 3)) && enPassantSquare != 64) {
-            // Check if it's an adjacent file
-            if (abs((int)getFile(enPassantSquare) - (int)getFile(square)) == 1) {
-                buffer[count++] = constructMove(square, target, 1, EN_PASSANT_FLAG);
-            }
-        }
+    while (doublePushes) {
+        U8 to = popLSB(doublePushes);
+        buffer[count++] = constructMove(to - 2*up, to, 0, NOTHING_FLAG);
     }
+
     return count;
 
 }
 
-int Chess::getBishopMoves(Move* buffer, U8 square) {
+int Chess::getEnPassantMoves(Move* buffer, bool legalOnly) {
     int count = 0;
-    U8 isWhite = currentTurn;
-
-    Bitboard occupiedByUs = isWhite ? whitePieces : blackPieces;
-    Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
-
-    // Define direction vectors
-    static const int directions[4] = {9, 7, -7, -9};
-    for (int dir : directions) {
-        int offset = dir;
-        int current = square;
+    if (enPassantSquare == 64) return count;
+
+    U8 us = currentTurn;
+    U8 them = !us;
+    U8 captured = enPassantSquare + (us ? -8 : 8);
+    if (pieceLocations[captured] != ((PAWN << 1) | them)) return count;
+
+    Bitboard attackers = pawnAttacks[them][enPassantSquare] & bitboards[PAWN][us];
+    while (attackers) {
+        U8 from = popLSB(attackers);
+
+        if (legalOnly) {
+            // Both pawns leave their squares at once, so test the king against the resulting board
+            Bitboard occ = (allPieces & ~getWithSetBit(from) & ~getWithSetBit(captured)) | getWithSetBit(enPassantSquare);
+            Bitboard theirPawns = bitboards[PAWN][them] & ~getWithSetBit(captured);
+            U8 king = kingSquare[us];
+            if ((pawnAttacks[us][king] & theirPawns) || (knightAttacks[king] & bitboards[KNIGHT][them]) ||
+                (kingAttacks[king] & bitboards[KING][them]) ||
+                (rookAttacks(king, occ) & (bitboards[ROOK][them] | bitboards[QUEEN][them])) ||
+                (bishopAttacks(king, occ) & (bitboards[BISHOP][them] | bitboards[QUEEN][them]))) continue;
+        }
 
-        while (true) {
-            int target = current + offset;
+        buffer[count++] = constructMove(from, enPassantSquare, 1, EN_PASSANT_FLAG);
+    }
 
-            if (target < 0 || target >= 64) break;
-            if (abs(getFile(target) - getFile(current)) != 1) break;
+    return count;
+}
 
-            Bitboard targetMask = 1ULL << target;
-            if (targetMask & occupiedByUs) break;
+int Chess::getBishopMoves(Move* buffer, U8 square, Bitboard targetMask) {
+    int count = 0;
+    U8 isWhite = currentTurn;
 
-            if (targetMask & occupiedByThem) {
-                buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-                break;
-            } 
+    Bitboard occupiedByUs = isWhite ? whitePieces : blackPieces;
+    Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
 
-            buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
-            current = target;
-        }
+    Bitboard targets = bishopAttacks(square, allPieces) & ~occupiedByUs & targetMask;
+    while (targets) {
+        U8 target = popLSB(targets);
+        buffer[count++] = constructMove(square, target, (getWithSetBit(target) & occupiedByThem) ? 1 : 0, NOTHING_FLAG);
     }
     return count;
 
 }
 
-int Chess::getKnightMoves(Move* buffer, U8 square) {
+int Chess::getKnightMoves(Move* buffer, U8 square, Bitboard targetMask) {
     int count = 0;
     U8 isWhite = currentTurn;
 
     Bitboard occupiedByUs = isWhite ? whitePieces : blackPieces;
     Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
 
-    const int knightOffsets[8] = {17, 15, 10, 6, -6, -10, -15, -17};
-
-    for (int i = 0; i < 8; i++) {
-        U8 target = square+knightOffsets[i];
-        if (!(getWithSetBit(target) & knightMoves[square])) continue;
-
-        Bitboard targetMask = 1ULL << target;
-        if (targetMask & occupiedByUs) continue;
-
-        if (targetMask & occupiedByThem) {
-                buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-                continue;
-            }
-            buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
+    Bitboard targets = knightAttacks[square] & ~occupiedByUs & targetMask;
+    while (targets) {
+        U8 target = popLSB(targets);
+        buffer[count++] = constructMove(square, target, (getWithSetBit(target) & occupiedByThem) ? 1 : 0, NOTHING_FLAG);
     }
 
     return count;
 }
 
-int Chess::getRookMoves(Move* buffer, U8 square) {
+int Chess::getRookMoves(Move* buffer, U8 square, Bitboard targetMask) {
     int count = 0;
     U8 isWhite = currentTurn;
 
-    // Directions: up, down, right, left
-    const int directions[4] = {8, -8, 1, -1};
-
     Bitboard occupiedByUs = isWhite ? whitePieces : blackPieces;
     Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
 
-    for (int dir = 0; dir < 4; ++dir) {
-        int offset = directions[dir];
-        int current = square;
-
-        while (true) {
-            int target = current+offset;
-
-            if (target < 0 || target >= 64) break;
-            if ((offset == 1 || offset == -1) && (target / 8 != (target - offset) / 8)) break;
-
-            Bitboard targetMask = 1ULL << target;
-            if (targetMask & occupiedByUs) break;
-
-            
-            if (targetMask & occupiedByThem) {
-                    buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-                    break;
-                }
-
-            buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
-            current = target;
-        }
+    Bitboard targets = rookAttacks(square, allPieces) & ~occupiedByUs & targetMask;
+    while (targets) {
+        U8 target = popLSB(targets);
+        buffer[count++] = constructMove(square, target, (getWithSetBit(target) & occupiedByThem) ? 1 : 0, NOTHING_FLAG);
     }
     return count;
 
 }
 
-int Chess::getQueenMoves(Move* buffer, U8 square) {
+int Chess::getQueenMoves(Move* buffer, U8 square, Bitboard targetMask) {
     int count = 0;
 
-    count += getBishopMoves(buffer+count, square);
-    count += getRookMoves(buffer+count, square);
+    count += getBishopMoves(buffer+count, square, targetMask);
+    count += getRookMoves(buffer+count, square, targetMask);
 
     return count;
 
@@ -216,24 +197,21 @@ int Chess::getKingMoves(Move* buffer, U8 square) {
     Bitboard occupiedByUs = isWhite ? whitePieces : blackPieces;
     Bitboard occupiedByThem = isWhite ? blackPieces : whitePieces;
 
-    const int squares[8] = {8, -8, -1, 1, 7, 9, -9, -7}; // Up, Down, Left, Right, Up-Left, Up-Right, Down-Left, Down-Right
+    Bitboard targets = kingAttacks[square] & ~occupiedByUs;
+    while (targets) {
+        U8 target = popLSB(targets);
+        buffer[count++] = constructMove(square, target, (getWithSetBit(target) & occupiedByThem) ? 1 : 0, NOTHING_FLAG);
+    }
 
-    for (int i=0; i<8; i++) {
-        U8 target = square+squares[i];
-        if (target >= 64) continue;
+    count += getCastlingMoves(buffer+count, square);
 
-        int fileDiff = abs(getFile(target) - getFile(square));
-        if (fileDiff > 1) continue;
+    return count;
 
-        Bitboard targetMask = 1ULL << target;
-        if (targetMask & occupiedByUs) continue;
+}
 
-        if (targetMask & occupiedByThem) {
-                buffer[count++] = constructMove(square, target, 1, NOTHING_FLAG);
-                continue;
-            }
-        buffer[count++] = constructMove(square, target, 0, NOTHING_FLAG);
-    }
+int Chess::getCastlingMoves(Move* buffer, U8 square) {
+    int count = 0;
+    U8 isWhite = currentTurn;
 
     // King side castle
     U8 offset = 2;
@@ -245,9 +223,9 @@ int Chess::getKingMoves(Move* buffer, U8 square) {
         bool rookPresent = (1ULL << (square + 3)) & (bitboards[ROOK][isWhite]);
 
         if (squaresEmpty && rookPresent) {
-            if (!isInCheck(square) &&
-                !isInCheck(square + 1) &&
-                !isInCheck(square + 2)) {
+            if (!isSquareAttacked(square, !isWhite, allPieces) &&
+                !isSquareAttacked(square + 1, !isWhite, allPieces) &&
+                !isSquareAttacked(square + 2, !isWhite, allPieces)) {
 
                 buffer[count++] = constructMove(square, square+offset, 0, CASTLE_FLAG);
             }
@@ -266,9 +244,9 @@ int Chess::getKingMoves(Move* buffer, U8 square) {
         bool rookPresent = (1ULL << (square - 4)) & (bitboards[ROOK][isWhite]);
     
         if (squaresEmpty && rookPresent) {
-            if (!isInCheck(square) &&
-                !isInCheck(square - 1) &&
-                !isInCheck(square - 2)) {
+            if (!isSquareAttacked(square, !isWhite, allPieces) &&
+                !isSquareAttacked(square - 1, !isWhite, allPieces) &&
+                !isSquareAttacked(square - 2, !isWhite, allPieces)) {
     
                 buffer[count++] = constructMove(square, square+offset, 0, CASTLE_FLAG);
             }
@@ -282,121 +260,121 @@ int Chess::getKingMoves(Move* buffer, U8 square) {
 int Chess::GenerateMoves(Move* buffer) {
 
     int count = 0;
+    U8 us = currentTurn;
 
-    for (int from = 0; from < 64; ++from) {
-        U8 pieceType = getPieceType(from);
-        if (pieceType==NO_PIECE || getPieceColor(from)!=currentTurn) continue;
+    count += getPawnMoves(buffer+count, bitboards[PAWN][us]);
+    count += getEnPassantMoves(buffer+count, false);
 
-        if (pieceType == PAWN) {
-            count += getPawnMoves(buffer+count, from);
-        }
-        else if (pieceType == BISHOP) {
-            count += getBishopMoves(buffer+count, from);
-        }
-        else if (pieceType == KNIGHT) {
-            count += getKnightMoves(buffer+count, from);
-        }
-        else if (pieceType == ROOK) {
-            count += getRookMoves(buffer+count, from);
-        }
-        else if (pieceType == QUEEN) {
-            count += getQueenMoves(buffer+count, from);
-        }
-        else if (pieceType == KING) {
-            count += getKingMoves(buffer+count, from);
-        }
+    Bitboard pieces = bitboards[KNIGHT][us];
+    while (pieces) count += getKnightMoves(buffer+count, popLSB(pieces));
 
-        
-    }
+    pieces = bitboards[BISHOP][us];
+    while (pieces) count += getBishopMoves(buffer+count, popLSB(pieces));
+
+    pieces = bitboards[ROOK][us];
+    while (pieces) count += getRookMoves(buffer+count, popLSB(pieces));
+
+    pieces = bitboards[QUEEN][us];
+    while (pieces) count += getQueenMoves(buffer+count, popLSB(pieces));
+
+    count += getKingMoves(buffer+count, kingSquare[us]);
 
     return count;
 }
 
-int Chess::GenerateLegalMoves(Move* buffer) {
+int Chess::GenerateLegalMoves(Move* buffer, bool capturesOnly) {
 
     int count = 0;
-    Move moveBuffer[256];
-
-    for (int from = 0; from < 64; ++from) {
-        U8 pieceType = getPieceType(from);
-        if (pieceType==NO_PIECE || getPieceColor(from)!=currentTurn) continue;
-
-        if (pieceType == PAWN) {
-            count += getPawnMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == BISHOP) {
-            count += getBishopMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == KNIGHT) {
-            count += getKnightMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == ROOK) {
-            count += getRookMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == QUEEN) {
-            count += getQueenMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == KING) {
-            count += getKingMoves(moveBuffer+count, from);
-        }
+    U8 us = currentTurn;
+    U8 them = !us;
+    U8 king = kingSquare[us];
+
+    Bitboard occupiedByUs = us ? whitePieces : blackPieces;
+    Bitboard occupiedByThem = us ? blackPieces : whitePieces;
+    Bitboard diagonalSliders = bitboards[BISHOP][them] | bitboards[QUEEN][them];
+    Bitboard straightSliders = bitboards[ROOK][them] | bitboards[QUEEN][them];
+
+    // Captures-only mode keeps enemy-occupied targets, plus promotion squares for pawns
+    Bitboard targetMask = capturesOnly ? occupiedByThem : ~0ULL;
+    Bitboard pawnTargetMask = capturesOnly ? occupiedByThem | (us ? RANK_8 : RANK_1) : ~0ULL;
+
+    Bitboard checkers = attackersTo(king, allPieces) & occupiedByThem;
+
+    // Our pieces standing alone between the king and an enemy slider
+    Bitboard pinned = 0ULL;
+    Bitboard snipers = (bishopAttacks(king, occupiedByThem) & diagonalSliders)
+                     | (rookAttacks(king, occupiedByThem) & straightSliders);
+    while (snipers) {
+        Bitboard blockers = betweenMasks[king][popLSB(snipers)] & allPieces;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & occupiedByUs)) pinned |= blockers;
     }
 
-    
+    // King steps, tested with the king lifted so it cannot hide behind itself
+    Bitboard kingless = allPieces ^ getWithSetBit(king);
+    Bitboard targets = kingAttacks[king] & ~occupiedByUs & targetMask;
+    while (targets) {
+        U8 to = popLSB(targets);
+        if (!isSquareAttacked(to, them, kingless))
+            buffer[count++] = constructMove(king, to, (getWithSetBit(to) & occupiedByThem) ? 1 : 0, NOTHING_FLAG);
+    }
 
-    int legalCounter = 0;
+    // Double check, only the king may move
+    if (checkers & (checkers - 1)) return count;
 
-    for (int i = 0; i < count; ++i) {
-        makeMove(moveBuffer[i]);
-        if (!isInCheck())
-            buffer[legalCounter++] = moveBuffer[i];
+    // Non-king moves must capture the checker or block its ray
+    Bitboard checkMask = ~0ULL;
+    if (checkers) {
+        checkMask = betweenMasks[king][__builtin_ctzll(checkers)] | checkers;
+    } else if (!capturesOnly) {
+        count += getCastlingMoves(buffer+count, king);
+    }
 
-        undoMove();
+    Bitboard pawns = bitboards[PAWN][us];
+    count += getPawnMoves(buffer+count, pawns & ~pinned, checkMask & pawnTargetMask);
+    Bitboard pinnedPawns = pawns & pinned;
+    while (pinnedPawns) {
+        U8 from = popLSB(pinnedPawns);
+        count += getPawnMoves(buffer+count, getWithSetBit(from), checkMask & pawnTargetMask & lineMasks[king][from]);
     }
+    count += getEnPassantMoves(buffer+count, true);
 
-    return legalCounter;
-}
+    checkMask &= targetMask;
 
+    // A pinned knight can never stay on the pin line
+    Bitboard pieces = bitboards[KNIGHT][us] & ~pinned;
+    while (pieces) count += getKnightMoves(buffer+count, popLSB(pieces), checkMask);
 
-// ------------------------------------------- JS MODULE -------------------------------------------
-std::vector<Move> Chess::GenerateLegalMovesJS() {
-    int count = 0;
-    std::vector<Move> LegalMoves;
-    Move moveBuffer[256];
+    pieces = bitboards[BISHOP][us];
+    while (pieces) {
+        U8 from = popLSB(pieces);
+        count += getBishopMoves(buffer+count, from, (pinned & getWithSetBit(from)) ? checkMask & lineMasks[king][from] : checkMask);
+    }
 
-    for (int from = 0; from < 64; ++from) {
-        U8 pieceType = getPieceType(from);
-        if (pieceType==NO_PIECE || getPieceColor(from)!=currentTurn) continue;
+    pieces = bitboards[ROOK][us];
+    while (pieces) {
+        U8 from = popLSB(pieces);
+        count += getRookMoves(buffer+count, from, (pinned & getWithSetBit(from)) ? checkMask & lineMasks[king][from] : checkMask);
+    }
 
-        if (pieceType == PAWN) {
-            count += getPawnMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == BISHOP) {
-            count += getBishopMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == KNIGHT) {
-            count += getKnightMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == ROOK) {
-            count += getRookMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == QUEEN) {
-            count += getQueenMoves(moveBuffer+count, from);
-        }
-        else if (pieceType == KING) {
-            count += getKingMoves(moveBuffer+count, from);
-        }
+    pieces = bitboards[QUEEN][us];
+    while (pieces) {
+        U8 from = popLSB(pieces);
+        count += getQueenMoves(buffer+count, from, (pinned & getWithSetBit(from)) ? checkMask & lineMasks[king][from] : checkMask);
     }
 
+    return count;
+}
 
 
-    for (int i = 0; i < count; ++i) {
-        makeMove(moveBuffer[i]);
-        if (!isInCheck()) {
-            Move move = moveBuffer[i];
-            LegalMoves.push_back(move);
-        }
-        undoMove();
-    }
+int Chess::GenerateLegalMoves(MoveList& list, bool capturesOnly) {
+    list.count = GenerateLegalMoves(list.moves, capturesOnly);
+    return list.count;
+}
+
+// ------------------------------------------- JS MODULE -------------------------------------------
+std::vector<Move> Chess::GenerateLegalMovesJS() {
+    MoveList list;
+    GenerateLegalMoves(list);
 
-    return LegalMoves;
+    return std::vector<Move>(list.begin(), list.end());
 }
\ No newline at end of file
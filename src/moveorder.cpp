@@ -0,0 +1,76 @@
+#include "chess.h"
+
+constexpr int HASH_MOVE_SCORE = 1000000;
+constexpr int CAPTURE_SCORE = 100000;
+constexpr int LOSING_CAPTURE_SCORE = -100000; // Below every quiet move
+constexpr int KILLER_SCORES[2] = {90000, 80000};
+constexpr int HISTORY_LIMIT = 60000; // Stays below the killer scores
+
+void Chess::scoreMoves(Move* moves, int* scores, int count, Move ttMove, int ply) {
+    U8 us = currentTurn;
+
+    for (int i=0; i<count; i++) {
+        Move move = moves[i];
+        U8 from = getFromSquare(move);
+        U8 to = getToSquare(move);
+        U8 promoted = getPromotedPiece(move);
+
+        if (move == ttMove) {
+            scores[i] = HASH_MOVE_SCORE;
+        } else if (isCaptureMove(move) || promoted == QUEEN) {
+            // MVV-LVA, most valuable victim first, least valuable attacker breaking ties
+            U8 victim = (getFlags(move) == EN_PASSANT_FLAG) ? (U8)PAWN : getPieceType(to);
+            int victimScore = isCaptureMove(move) ? 8 * (victim + 1) : 0;
+            scores[i] = CAPTURE_SCORE + victimScore - getPieceType(from) + (promoted == QUEEN ? 8 * QUEEN : 0);
+
+            // Only a capture by a more valuable piece can lose material
+            if (isCaptureMove(move) && pieceValues[getPieceType(from)] > pieceValues[victim] && see(move) < 0)
+                scores[i] += LOSING_CAPTURE_SCORE - CAPTURE_SCORE;
+        } else if (ply < MAX_PLY && move == killers[ply][0]) {
+            scores[i] = KILLER_SCORES[0];
+        } else if (ply < MAX_PLY && move == killers[ply][1]) {
+            scores[i] = KILLER_SCORES[1];
+        } else {
+            scores[i] = history[us][from][to];
+        }
+    }
+}
+
+// One step of selection sort, so only the moves actually searched get sorted
+Move Chess::pickMove(Move* moves, int* scores, int count, int index) {
+    int best = index;
+    for (int i=index+1; i<count; i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+    return moves[index];
+}
+
+void Chess::updateQuietStats(Move move, int depth, int ply) {
+    if (ply < MAX_PLY && killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    int& entry = history[currentTurn][getFromSquare(move)][getToSquare(move)];
+    entry += depth * depth;
+
+    if (entry > HISTORY_LIMIT) {
+        for (int color = 0; color < 2; color++)
+            for (int from = 0; from < 64; from++)
+                for (int to = 0; to < 64; to++)
+                    history[color][from][to] /= 2;
+    }
+}
+
+// Killers belong to one search, history is kept but decayed
+void Chess::resetOrdering() {
+    memset(killers, 0, sizeof(killers));
+
+    for (int color = 0; color < 2; color++)
+        for (int from = 0; from < 64; from++)
+            for (int to = 0; to < 64; to++)
+                history[color][from][to] /= 2;
+}
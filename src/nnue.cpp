@@ -0,0 +1,169 @@
+#include "chess.h"
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+Network* Chess::network = nullptr;
+
+static const int16_t zeroRow[NNUE_HIDDEN] = {};
+
+// acc += add - sub over one accumulator half
+static void accumulateScalar(int16_t* acc, const int16_t* add, const int16_t* sub) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] += add[i] - sub[i];
+}
+
+// Clipped ReLU of both halves dotted with the output weights
+static int32_t outputScalar(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    int32_t sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        sum += std::clamp<int>(us[i], 0, NNUE_QA) * weights[i];
+        sum += std::clamp<int>(them[i], 0, NNUE_QA) * weights[NNUE_HIDDEN + i];
+    }
+    return sum;
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("avx2")))
+static void accumulateAvx2(int16_t* acc, const int16_t* add, const int16_t* sub) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+        a = _mm256_add_epi16(a, _mm256_loadu_si256((const __m256i*)(add + i)));
+        a = _mm256_sub_epi16(a, _mm256_loadu_si256((const __m256i*)(sub + i)));
+        _mm256_store_si256((__m256i*)(acc + i), a);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t outputAvx2(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NNUE_QA);
+    __m256i sum = zero;
+
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i x = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(us + i)), zero), qa);
+        __m256i y = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(them + i)), zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, _mm256_loadu_si256((const __m256i*)(weights + i))));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(y, _mm256_loadu_si256((const __m256i*)(weights + NNUE_HIDDEN + i))));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("sse2")))
+static void accumulateSse2(int16_t* acc, const int16_t* add, const int16_t* sub) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+        a = _mm_add_epi16(a, _mm_loadu_si128((const __m128i*)(add + i)));
+        a = _mm_sub_epi16(a, _mm_loadu_si128((const __m128i*)(sub + i)));
+        _mm_store_si128((__m128i*)(acc + i), a);
+    }
+}
+
+__attribute__((target("sse2")))
+static int32_t outputSse2(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NNUE_QA);
+    __m128i sum = zero;
+
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i x = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(us + i)), zero), qa);
+        __m128i y = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(them + i)), zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(x, _mm_loadu_si128((const __m128i*)(weights + i))));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(y, _mm_loadu_si128((const __m128i*)(weights + NNUE_HIDDEN + i))));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#endif
+
+// Picked once per network load from what the CPU supports
+static void (*accumulate)(int16_t*, const int16_t*, const int16_t*) = accumulateScalar;
+static int32_t (*output)(const int16_t*, const int16_t*, const int16_t*) = outputScalar;
+
+static const char* selectKernels() {
+#ifdef NNUE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        accumulate = accumulateAvx2;
+        output = outputAvx2;
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        accumulate = accumulateSse2;
+        output = outputSse2;
+        return "sse2";
+    }
+#endif
+    accumulate = accumulateScalar;
+    output = outputScalar;
+    return "scalar";
+}
+
+// Each perspective sees its own pieces first and the board from its own side
+static const int16_t* featureRow(U8 perspective, U8 piece, U8 color, U8 square) {
+    int index = (color == perspective ? 0 : 6 * 64) + piece * 64 + (perspective == WHITE ? square : square ^ 56);
+    return Chess::network->featureWeights + index * NNUE_HIDDEN;
+}
+
+// Raw little-endian int16: feature weights [768][HIDDEN], feature bias [HIDDEN],
+// output weights [2 * HIDDEN] (side to move first), output bias
+bool Chess::loadNetwork(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    Network* loaded = new Network();
+    file.read((char*)loaded->featureWeights, sizeof(loaded->featureWeights));
+    file.read((char*)loaded->featureBias, sizeof(loaded->featureBias));
+    file.read((char*)loaded->outputWeights, sizeof(loaded->outputWeights));
+    file.read((char*)&loaded->outputBias, sizeof(loaded->outputBias));
+
+    // Anything short or trailing is a different architecture
+    if (!file || file.peek() != EOF) {
+        delete loaded;
+        return false;
+    }
+
+    std::cerr << "Loaded network " << path << " (" << selectKernels() << ")" << std::endl; // stdout may be machine readable
+    delete network;
+    network = loaded;
+    return true;
+}
+
+void Chess::refreshAccumulator() {
+    if (!network) return;
+
+    for (U8 perspective = BLACK; perspective <= WHITE; perspective++) {
+        memcpy(accumulator.values[perspective], network->featureBias, sizeof(network->featureBias));
+        for (U8 sq = 0; sq < 64; sq++) {
+            if (pieceLocations[sq] == EMPTY_SQUARE) continue;
+            accumulate(accumulator.values[perspective], featureRow(perspective, pieceLocations[sq] >> 1, pieceLocations[sq] & 1, sq), zeroRow);
+        }
+    }
+}
+
+// A piece appears on addSquare and/or leaves subSquare, -1 for neither
+void Chess::updateAccumulator(U8 piece, U8 color, int addSquare, int subSquare) {
+    for (U8 perspective = BLACK; perspective <= WHITE; perspective++) {
+        const int16_t* add = addSquare >= 0 ? featureRow(perspective, piece, color, addSquare) : zeroRow;
+        const int16_t* sub = subSquare >= 0 ? featureRow(perspective, piece, color, subSquare) : zeroRow;
+        accumulate(accumulator.values[perspective], add, sub);
+    }
+}
+
+Eval Chess::evaluateNetwork() {
+    int32_t sum = output(accumulator.values[currentTurn], accumulator.values[!currentTurn], network->outputWeights);
+    int score = (sum + network->outputBias) * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+
+    // Keep clear of the mate range, then report from White's side like evaluate()
+    score = std::clamp(score, -MATE_BOUND + 1, MATE_BOUND - 1);
+    return currentTurn ? score : -score;
+}
@@ -0,0 +1,85 @@
+#include "chess.h"
+
+// Passed pawn bonus by rank from the pawn's own side
+static const int passedMg[8] = {0, 5, 10, 15, 30, 50, 80, 0};
+static const int passedEg[8] = {0, 10, 20, 35, 60, 100, 150, 0};
+
+constexpr int DOUBLED_MG = -10, DOUBLED_EG = -20;
+constexpr int ISOLATED_MG = -10, ISOLATED_EG = -15;
+constexpr int BACKWARD_MG = -8, BACKWARD_EG = -10;
+
+static Bitboard forward(Bitboard b, U8 color) {
+    return color == WHITE ? b << 8 : b >> 8;
+}
+
+// Every square in front of the set, the set itself included
+static Bitboard forwardFill(Bitboard b, U8 color) {
+    for (int shift = 8; shift <= 32; shift *= 2) b |= color == WHITE ? b << shift : b >> shift;
+    return b;
+}
+
+static Bitboard pawnAttackSet(Bitboard b, U8 color) {
+    Bitboard pushed = forward(b, color);
+    return ((pushed << 1) & notAFile) | ((pushed >> 1) & notHFile);
+}
+
+static Bitboard fileFill(Bitboard b) {
+    return forwardFill(b, WHITE) | forwardFill(b, BLACK);
+}
+
+void Chess::evaluatePawns(PawnEntry* entry) {
+    int mg = 0, eg = 0;
+    Bitboard attackSpans[2], frontSpans[2];
+
+    for (U8 color = BLACK; color <= WHITE; color++) {
+        Bitboard pawns = bitboards[PAWN][color];
+        attackSpans[color] = forwardFill(pawnAttackSet(pawns, color), color);
+        frontSpans[color] = forwardFill(forward(pawns, color), color);
+    }
+
+    for (U8 color = BLACK; color <= WHITE; color++) {
+        Bitboard pawns = bitboards[PAWN][color];
+        U8 them = !color;
+        int sign = color == WHITE ? 1 : -1;
+        int colorMg = 0, colorEg = 0;
+
+        // Any pawn with a friendly pawn in front of it
+        Bitboard doubledPawns = pawns & frontSpans[color];
+        int doubled = countBits(doubledPawns);
+
+        Bitboard files = fileFill(pawns);
+        Bitboard isolated = pawns & ~(((files << 1) & notAFile) | ((files >> 1) & notHFile));
+
+        // Stop square held by an enemy pawn and out of reach of any friendly pawn
+        Bitboard stops = forward(pawns, color) & pawnAttackSet(bitboards[PAWN][them], them) & ~attackSpans[color];
+        Bitboard backward = forward(stops, them) & ~isolated;
+
+        Bitboard passed = pawns & ~(frontSpans[them] | attackSpans[them]);
+        entry->passed[color] = passed;
+
+        colorMg += doubled * DOUBLED_MG + countBits(isolated) * ISOLATED_MG + countBits(backward) * BACKWARD_MG;
+        colorEg += doubled * DOUBLED_EG + countBits(isolated) * ISOLATED_EG + countBits(backward) * BACKWARD_EG;
+
+        while (passed) {
+            int sq = popLSB(passed);
+            int rank = color == WHITE ? sq / 8 : 7 - sq / 8;
+            colorMg += passedMg[rank];
+            colorEg += passedEg[rank];
+        }
+
+        mg += sign * colorMg;
+        eg += sign * colorEg;
+    }
+
+    entry->key = pawnKey;
+    entry->mg = mg;
+    entry->eg = eg;
+    entry->attackSpans[BLACK] = attackSpans[BLACK];
+    entry->attackSpans[WHITE] = attackSpans[WHITE];
+}
+
+PawnEntry* Chess::probePawns() {
+    PawnEntry* entry = pawnTable.probe(pawnKey);
+    if (entry->key != pawnKey) evaluatePawns(entry);
+    return entry;
+}
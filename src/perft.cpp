@@ -1,6 +1,8 @@
 #include "chess.h"
+#include <thread>
+#include <atomic>
 
-Bitboard Chess::perft(int depth, int* mates, int originalDepth) {
+Bitboard Chess::perft(int depth, int* mates, int originalDepth, bool bulk) {
     
     if (originalDepth == -1) originalDepth = depth;
     if (depth == 0) return 1;
@@ -8,20 +10,17 @@ Bitboard Chess::perft(int depth, int* mates, int originalDepth) {
     Bitboard nodes = 0;
     Move moveBuffer[256];
 
-    int moveCount = GenerateMoves(moveBuffer);
+    int moveCount = GenerateLegalMoves(moveBuffer);
     
     for (int i=0; i<moveCount; i++) {
         Move move = moveBuffer[i];
         makeMove(move);
         
-        bool isLegal = !isInCheck();
-        if (isLegal) {
-            Bitboard inc = perft(depth - 1, mates, originalDepth);;
-            nodes += inc;
+        Bitboard inc = perftNodes(depth - 1, bulk);
+        nodes += inc;
 
-            if (depth == originalDepth) std::cout << notationFromSquare(move) << ": " << inc << " - " << *mates<< "\n"; 
+        if (depth == originalDepth) std::cout << notationFromSquare(move) << ": " << inc << " - " << *mates<< "\n"; 
 
-        }
         // if (isCheckMate()) {
         //     (*mates)++;
         //     displayBoard();
@@ -31,4 +30,123 @@ Bitboard Chess::perft(int depth, int* mates, int originalDepth) {
     }
 
     return nodes;
-}
\ No newline at end of file
+}
+
+Bitboard Chess::perftNodes(int depth, bool bulk) {
+    if (depth == 0) return 1;
+
+    Bitboard nodes = 0;
+    Move moveBuffer[MAX_MOVES];
+
+    int moveCount = GenerateLegalMoves(moveBuffer);
+
+    // The generator is fully legal, so the frontier is just the move count
+    if (bulk && depth == 1) return moveCount;
+
+    for (int i=0; i<moveCount; i++) {
+        makeMove(moveBuffer[i]);
+        nodes += perftNodes(depth - 1, bulk);
+        undoMove();
+    }
+
+    return nodes;
+}
+
+Bitboard Chess::hashedPerft(int depth, PerftTable& table, int originalDepth) {
+
+    if (originalDepth == -1) originalDepth = depth;
+    if (depth == 0) return 1;
+
+    uint64_t cached;
+    if (depth != originalDepth && table.probe(hashKey, depth, cached)) return cached;
+
+    Bitboard nodes = 0;
+    Move moveBuffer[MAX_MOVES];
+
+    int moveCount = GenerateLegalMoves(moveBuffer);
+    if (depth == 1 && depth != originalDepth) return moveCount;
+
+    for (int i=0; i<moveCount; i++) {
+        Move move = moveBuffer[i];
+        makeMove(move);
+
+        Bitboard inc = hashedPerft(depth - 1, table, originalDepth);
+        nodes += inc;
+
+        if (depth == originalDepth) std::cout << notationFromSquare(move) << ": " << inc << "\n";
+
+        undoMove();
+    }
+
+    table.store(hashKey, depth, nodes);
+
+    return nodes;
+}
+
+
+// Every move sequence of length depth from here, stored back to back, tagged with the root move it starts with
+void Chess::collectSplitPoints(int depth, Move* line, int ply, int rootIndex, std::vector<Move>& lines, std::vector<int>& rootIndices) {
+    if (ply == depth) {
+        lines.insert(lines.end(), line, line + depth);
+        rootIndices.push_back(rootIndex);
+        return;
+    }
+
+    Move moveBuffer[MAX_MOVES];
+    int moveCount = GenerateLegalMoves(moveBuffer);
+
+    for (int i=0; i<moveCount; i++) {
+        line[ply] = moveBuffer[i];
+        makeMove(moveBuffer[i]);
+        collectSplitPoints(depth, line, ply + 1, ply == 0 ? i : rootIndex, lines, rootIndices);
+        undoMove();
+    }
+}
+
+Bitboard Chess::parallelPerft(int depth, int threads, int splitDepth) {
+
+    if (depth == 0) return 1;
+    splitDepth = std::max(1, std::min(splitDepth, depth));
+    threads = std::max(1, threads);
+
+    Move rootMoves[MAX_MOVES];
+    int rootCount = GenerateLegalMoves(rootMoves);
+
+    Move line[MAX_DEPTH];
+    std::vector<Move> lines;
+    std::vector<int> rootIndices;
+    collectSplitPoints(splitDepth, line, 0, 0, lines, rootIndices);
+
+    std::vector<Bitboard> results(rootIndices.size());
+    std::atomic<size_t> nextItem{0};
+
+    auto worker = [&]() {
+        Chess* board = new Chess(*this);
+        board->tt = nullptr;
+
+        size_t item;
+        while ((item = nextItem.fetch_add(1)) < results.size()) {
+            for (int i = 0; i < splitDepth; i++) board->makeMove(lines[item * splitDepth + i]);
+            results[item] = board->perftNodes(depth - splitDepth);
+            for (int i = 0; i < splitDepth; i++) board->undoMove();
+        }
+
+        delete board;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+    for (std::thread& t : pool) t.join();
+
+    // Merge in root move order so the divide output is identical for any thread count
+    std::vector<Bitboard> divide(rootCount, 0);
+    for (size_t i = 0; i < results.size(); i++) divide[rootIndices[i]] += results[i];
+
+    Bitboard nodes = 0;
+    for (int i = 0; i < rootCount; i++) {
+        std::cout << notationFromSquare(rootMoves[i]) << ": " << divide[i] << "\n";
+        nodes += divide[i];
+    }
+
+    return nodes;
+}
@@ -0,0 +1,272 @@
+#include "chess.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+std::string PgnGame::tag(const std::string& name) const {
+    for (const auto& pair : tags)
+        if (pair.first == name) return pair.second;
+    return "";
+}
+
+static void parseTag(const std::string& line, PgnGame& game) {
+    size_t nameEnd = line.find_first_of(" \t\"]", 1);
+    size_t quote = line.find('"');
+    if (nameEnd == std::string::npos || quote == std::string::npos) return;
+
+    std::string value;
+    for (size_t i = quote + 1; i < line.size() && line[i] != '"'; i++) {
+        if (line[i] == '\\' && i + 1 < line.size()) i++;
+        value += line[i];
+    }
+    game.tags.emplace_back(line.substr(1, nameEnd - 1), value);
+}
+
+// A game ends at a blank line after its movetext, or where the next game's tags begin after its
+// movetext or a blank line (a game without moves)
+bool PgnReader::next(PgnGame& game) {
+    game.tags.clear();
+    game.movetext.clear();
+
+    bool inMovetext = false;
+    int braceDepth = 0; // Comments may span lines, blank ones included
+    bool afterBlank = false; // Tags followed by a blank line, more tags start another game
+    std::string line;
+
+    while (!pending.empty() || getline(input, line)) {
+        if (!pending.empty()) line.swap(pending), pending.clear();
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            if (inMovetext && braceDepth == 0) return true;
+            afterBlank = !game.tags.empty();
+            if (braceDepth) game.movetext += '\n';
+            continue;
+        }
+
+        if (braceDepth == 0 && line[first] == '[') {
+            if (inMovetext || afterBlank) {
+                pending = line;
+                return true;
+            }
+            parseTag(line.substr(first), game);
+        } else if (braceDepth == 0 && line[first] == '%') {
+            continue;
+        } else {
+            inMovetext = true;
+            for (char c : line) braceDepth += (c == '{') - (c == '}' && braceDepth > 0);
+            game.movetext += line;
+            game.movetext += '\n';
+        }
+    }
+
+    return !game.tags.empty() || !game.movetext.empty();
+}
+
+static bool isResult(std::string_view token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// Plays the main line from the game's start position. On failure 'error' names the
+// offending token and 'moves' holds everything before it.
+bool replayPgn(Chess& board, const PgnGame& game, std::vector<Move>& moves, std::string& error) {
+    moves.clear();
+
+    std::string fen = game.tag("FEN");
+    if (!fen.empty() && !Chess::isValidFen(fen)) {
+        error = "bad FEN tag";
+        return false;
+    }
+    board.loadFen(fen.empty() ? startFen : fen);
+
+    std::string_view text = game.movetext;
+    int variationDepth = 0;
+    size_t i = 0;
+
+    while (i < text.size()) {
+        char c = text[i];
+
+        if (isspace((unsigned char)c)) { i++; continue; }
+        if (c == '{') { i = std::min(text.find('}', i), text.size()) + 1; continue; }
+        if (c == ';') { i = std::min(text.find('\n', i), text.size()); continue; }
+        if (c == '(') { variationDepth++; i++; continue; }
+        if (c == ')') { variationDepth = std::max(0, variationDepth - 1); i++; continue; }
+
+        size_t end = text.find_first_of(" \t\r\n{}();", i);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view token = text.substr(i, end - i);
+        i = end;
+
+        if (variationDepth > 0 || token[0] == '$' || isResult(token)) continue;
+
+        // Move numbers, possibly glued to the move ("12.e4", "12...Nf6")
+        if (isdigit((unsigned char)token[0]) && token != "0-0" && token != "0-0-0") {
+            size_t digits = token.find_first_not_of("0123456789");
+            if (digits == std::string_view::npos || token[digits] != '.') {
+                error = "bad token '" + std::string(token) + "'";
+                return false;
+            }
+            token.remove_prefix(digits);
+        }
+        while (!token.empty() && token[0] == '.') token.remove_prefix(1);
+        if (token.empty()) continue;
+
+        Move move = board.parseSan(token);
+        if (!move) {
+            error = "illegal move '" + std::string(token) + "' at ply " + std::to_string(moves.size() + 1);
+            return false;
+        }
+
+        board.makeMove(move);
+        moves.push_back(move);
+    }
+
+    return true;
+}
+
+// Tags as given (SetUp/FEN are added for a non-standard start), then the movetext wrapped at 80 columns
+void writePgn(std::ostream& out, const Chess& start, const std::vector<std::pair<std::string, std::string>>& tags,
+              const Move* moves, int count, const std::string& result) {
+    Chess* board = new Chess(start);
+    std::string fen = board->getFen();
+    bool standard = fen == startFen;
+
+    for (const auto& pair : tags) {
+        out << '[' << pair.first << " \"";
+        for (char c : pair.second) out << (c == '"' || c == '\\' ? "\\" : "") << c;
+        out << "\"]\n";
+    }
+    bool hasFen = std::any_of(tags.begin(), tags.end(), [](const auto& pair) { return pair.first == "FEN"; });
+    if (!standard && !hasFen) out << "[SetUp \"1\"]\n[FEN \"" << fen << "\"]\n";
+    out << '\n';
+
+    std::string line;
+    auto append = [&](const std::string& token) {
+        if (!line.empty() && line.size() + 1 + token.size() > 79) {
+            out << line << '\n';
+            line.clear();
+        }
+        if (!line.empty()) line += ' ';
+        line += token;
+    };
+
+    for (int i = 0; i < count; i++) {
+        char san[16];
+        board->writeSan(moves[i], san, sizeof(san));
+
+        if (board->currentTurn) append(std::to_string(board->fullmoveNumber) + ".");
+        else if (i == 0) append(std::to_string(board->fullmoveNumber) + "...");
+        append(san);
+
+        Move move = moves[i];
+        board->makeMove(move);
+    }
+    append(result);
+    out << line << "\n\n";
+
+    delete board;
+}
+
+// Reads games on this thread and replays them on the workers, one engine each. Prints one tab
+// separated line per game in input order: result, ply count, moves in UCI notation; or "error"
+// and the reason.
+int runPgnImport(const std::string& path, int threads) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Could not open " << path << std::endl;
+            return 2;
+        }
+    }
+    PgnReader reader(path == "-" ? std::cin : file);
+
+    const size_t QUEUE_LIMIT = 1024;
+    std::deque<std::pair<size_t, PgnGame>> queue;
+    std::mutex queueMutex, outputMutex;
+    std::condition_variable queueChanged;
+    bool finished = false;
+
+    size_t nextToPrint = 0, errors = 0;
+    uint64_t totalPlies = 0;
+    std::map<size_t, std::string> pending;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        Chess* board = new Chess();
+        board->init(startFen);
+        std::vector<Move> moves;
+        std::string error;
+
+        while (true) {
+            std::pair<size_t, PgnGame> item;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueChanged.wait(lock, [&]() { return !queue.empty() || finished; });
+                if (queue.empty()) break;
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            queueChanged.notify_all();
+
+            std::string result;
+            bool ok = replayPgn(*board, item.second, moves, error);
+            if (ok) {
+                std::string tagResult = item.second.tag("Result");
+                result = (tagResult.empty() ? "*" : tagResult) + "\t" + std::to_string(moves.size()) + "\t";
+                for (size_t i = 0; i < moves.size(); i++) {
+                    if (i) result += ' ';
+                    result += board->notationFromSquare(moves[i]);
+                }
+            } else {
+                result = "error\t" + error;
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (ok) totalPlies += moves.size();
+            else errors++;
+
+            pending[item.first] = std::move(result);
+            for (auto it = pending.find(nextToPrint); it != pending.end(); it = pending.find(++nextToPrint)) {
+                std::cout << it->second << '\n';
+                pending.erase(it);
+            }
+        }
+
+        delete board;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, threads); t++) pool.emplace_back(worker);
+
+    size_t games = 0;
+    PgnGame game;
+    while (reader.next(game)) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [&]() { return queue.size() < QUEUE_LIMIT; });
+        queue.emplace_back(games++, std::move(game));
+        lock.unlock();
+        queueChanged.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finished = true;
+    }
+    queueChanged.notify_all();
+
+    for (std::thread& t : pool) t.join();
+    std::cout.flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << games << " games, " << errors << " errors, " << totalPlies << " plies in " << seconds << "s, "
+              << (uint64_t)(games / std::max(seconds, 1e-3)) << " games/s" << std::endl;
+
+    return errors ? 1 : 0;
+}
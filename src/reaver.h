@@ -0,0 +1,83 @@
+#pragma once
+
+// Plain C interface to the engine. Every handle owns its own position and hash
+// table, so different handles may be used from different threads at once; a single
+// handle must not be used by two threads at the same time, except reaver_stop().
+// Nothing allocates after reaver_create() returns.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ReaverEngine ReaverEngine;
+
+// from | to << 6 | capture << 12 | flags << 13, the engine's own encoding
+typedef uint16_t ReaverMove;
+
+// Zero means unlimited, at least one limit should be set
+typedef struct {
+    int32_t depth;
+    uint64_t nodes;
+    int64_t movetime; // milliseconds
+} ReaverLimits;
+
+typedef struct {
+    ReaverMove bestMove; // 0 when there is no legal move
+    int32_t score; // centipawns for the side to move
+    int32_t mate; // moves to mate, negative when being mated, 0 otherwise
+    int32_t depth;
+    uint64_t nodes;
+    double ms;
+} ReaverSearchResult;
+
+enum {
+    REAVER_OK = 0,
+    REAVER_INVALID_ARGUMENT = -1,
+    REAVER_ILLEGAL_MOVE = -2,
+    REAVER_NO_MOVE = -3
+};
+
+#define REAVER_MAX_MOVES 256
+#define REAVER_MAX_GAME_PLIES 4096 // History reserved by reaver_create(), enough for any real game
+
+// Returns NULL when out of memory. hashMegabytes of 0 searches without a table.
+ReaverEngine* reaver_create(size_t hashMegabytes);
+void reaver_destroy(ReaverEngine* engine);
+
+// The position starts as the standard initial one
+int reaver_set_fen(ReaverEngine* engine, const char* fen);
+
+// Writes at most size bytes including the terminator, returns the full length
+size_t reaver_get_fen(ReaverEngine* engine, char* buffer, size_t size);
+
+// Writes at most capacity moves, returns the number of legal moves
+int reaver_legal_moves(ReaverEngine* engine, ReaverMove* moves, int capacity);
+
+// Both return REAVER_INVALID_ARGUMENT once REAVER_MAX_GAME_PLIES moves are on the board
+// since the last reaver_set_fen()
+int reaver_make_move(ReaverEngine* engine, ReaverMove move);
+int reaver_make_uci(ReaverEngine* engine, const char* uci);
+int reaver_unmake_move(ReaverEngine* engine);
+
+// Long algebraic notation, buffer needs room for 6 bytes
+void reaver_move_to_uci(ReaverMove move, char* buffer);
+
+// SAN of a legal move in the current position, same buffer rules as reaver_get_fen,
+// returns 0 for an illegal move
+size_t reaver_move_to_san(ReaverEngine* engine, ReaverMove move, char* buffer, size_t size);
+
+int reaver_side_to_move(ReaverEngine* engine); // 1 = White, 0 = Black
+int reaver_in_check(ReaverEngine* engine);
+
+uint64_t reaver_perft(ReaverEngine* engine, int depth);
+int reaver_search(ReaverEngine* engine, const ReaverLimits* limits, ReaverSearchResult* result);
+
+// Safe from any thread, ends the running search on this handle early
+void reaver_stop(ReaverEngine* engine);
+
+#ifdef __cplusplus
+}
+#endif
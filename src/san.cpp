@@ -0,0 +1,145 @@
+#include "chess.h"
+
+static const char pieceLetters[6] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+
+// Squares from which a piece of this type could reach the square, for both SAN directions
+static Bitboard reachOf(Chess& board, U8 piece, U8 square) {
+    switch (piece)
+    {
+    case KNIGHT: return board.knightAttacks[square];
+    case BISHOP: return board.bishopAttacks(square, board.allPieces);
+    case ROOK: return board.rookAttacks(square, board.allPieces);
+    case QUEEN: return board.bishopAttacks(square, board.allPieces) | board.rookAttacks(square, board.allPieces);
+    case KING: return board.kingAttacks[square];
+    default: return 0;
+    }
+}
+
+// SAN of a legal move in the current position, written without allocating. Returns the full length.
+size_t Chess::writeSan(Move move, char* buffer, size_t size) {
+    char san[16];
+    size_t length = 0;
+
+    U8 from = getFromSquare(move);
+    U8 to = getToSquare(move);
+    U8 piece = getPieceType(from);
+
+    if (getFlags(move) == CASTLE_FLAG) {
+        const char* castle = getFile(to) == KING_SIDE_CASTLE_FILE ? "O-O" : "O-O-O";
+        length = strlen(castle);
+        memcpy(san, castle, length);
+    } else {
+        if (piece != PAWN) {
+            san[length++] = pieceLetters[piece];
+
+            // Other pieces of the same kind that could legally go to the same square
+            Bitboard others = reachOf(*this, piece, to) & bitboards[piece][currentTurn] & ~getWithSetBit(from);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            while (others) {
+                U8 other = popLSB(others);
+                if (!isLegal(constructMove(other, to, isCaptureMove(move), NOTHING_FLAG))) continue;
+                ambiguous = true;
+                sameFile |= getFile(other) == getFile(from);
+                sameRank |= getRank(other) == getRank(from);
+            }
+            if (ambiguous && (!sameFile || sameRank)) san[length++] = getFile(from) + 'a';
+            if (ambiguous && sameFile) san[length++] = getRank(from) + '1';
+        }
+
+        if (isCaptureMove(move)) {
+            if (piece == PAWN) san[length++] = getFile(from) + 'a';
+            san[length++] = 'x';
+        }
+        san[length++] = getFile(to) + 'a';
+        san[length++] = getRank(to) + '1';
+
+        U8 promoted = getPromotedPiece(move);
+        if (promoted != NO_PIECE) {
+            san[length++] = '=';
+            san[length++] = pieceLetters[promoted];
+        }
+    }
+
+    makeMove(move);
+    if (isInCheck(-1, true)) {
+        Move moveBuffer[MAX_MOVES];
+        san[length++] = GenerateLegalMoves(moveBuffer) ? '+' : '#';
+    }
+    undoMove();
+
+    if (size) {
+        size_t copied = std::min(length, size - 1);
+        memcpy(buffer, san, copied);
+        buffer[copied] = '\0';
+    }
+    return length;
+}
+
+// Reads a SAN move (PGN style, annotations allowed) against the current position. Candidates
+// come straight from the piece bitboards, so no move list is generated. 0 if illegal or ambiguous.
+Move Chess::parseSan(std::string_view san) {
+    while (!san.empty() && strchr("+#!?", san.back())) san.remove_suffix(1);
+    if (san.size() < 2) return 0;
+
+    U8 us = currentTurn;
+    U8 king = kingSquare[us];
+    if (san == "O-O" || san == "0-0") return moveFromSquares(king, king + 2);
+    if (san == "O-O-O" || san == "0-0-0") return moveFromSquares(king, king - 2);
+
+    int piece = PAWN;
+    const char* letter = strchr("NBRQK", san[0]);
+    if (letter) {
+        piece = (letter - "NBRQK") + KNIGHT;
+        san.remove_prefix(1);
+    }
+
+    int promotion = NO_PIECE;
+    if (piece == PAWN && san.size() >= 3 && strchr("NBRQ", san.back())) {
+        promotion = (strchr("NBRQ", san.back()) - "NBRQ") + KNIGHT;
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+    }
+
+    if (san.size() < 2) return 0;
+    char toFile = san[san.size() - 2], toRank = san[san.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return 0;
+    U8 to = (toRank - '1') * 8 + (toFile - 'a');
+    san.remove_suffix(2);
+
+    // What is left is disambiguation and the capture mark
+    int fromFile = -1, fromRank = -1;
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') fromFile = c - 'a';
+        else if (c >= '1' && c <= '8') fromRank = c - '1';
+        else if (c != 'x' && c != '-' && c != ':') return 0;
+    }
+
+    Bitboard candidates;
+    if (piece == PAWN) {
+        int up = us ? 8 : -8;
+        if (fromFile >= 0 && fromFile != getFile(to)) {
+            candidates = pawnAttacks[!us][to] & bitboards[PAWN][us];
+        } else {
+            int single = to - up, twice = to - 2 * up;
+            candidates = 0;
+            if (single >= 0 && single < 64 && (bitboards[PAWN][us] & getWithSetBit(single))) candidates = getWithSetBit(single);
+            else if (twice >= 0 && twice < 64 && pieceLocations[single] == EMPTY_SQUARE) candidates = getWithSetBit(twice) & bitboards[PAWN][us];
+        }
+    } else {
+        candidates = reachOf(*this, piece, to) & bitboards[piece][us];
+    }
+
+    Move found = 0;
+    while (candidates) {
+        U8 from = popLSB(candidates);
+        if (fromFile >= 0 && getFile(from) != fromFile) continue;
+        if (fromRank >= 0 && getRank(from) != fromRank) continue;
+
+        Move move = moveFromSquares(from, to, promotion);
+        if (!move) continue;
+        if (found) return 0;
+        found = move;
+    }
+
+    return found;
+}
@@ -1,30 +1,259 @@
 #include "chess.h"
+#include <thread>
 
+// Mate scores are stored relative to the node rather than the root
+static int scoreToTT(int score, int ply) {
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
 
-Eval Chess::negaMax(int depth, int alpha, int beta) {
-    if (depth==0) return evaluate();
+static int scoreFromTT(int score, int ply) {
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
 
-    int maxEval = -INF;
+double Chess::elapsedMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+}
+
+// Node limit on every call, clock and external signal only every 2048 nodes
+bool Chess::checkStop() {
+    if (limits.nodes && nodes >= limits.nodes) stopped = true;
+    if ((nodes & 2047) == 0) {
+        if (limits.movetime && elapsedMs() >= limits.movetime) stopped = true;
+        if (stopSignal && stopSignal->load(std::memory_order_relaxed)) stopped = true;
+    }
+    return stopped;
+}
+
+Eval Chess::quiescence(int alpha, int beta, int ply) {
+    nodes++;
+    if (checkStop()) return 0;
+
+    Eval standPat = currentTurn ? evaluate() : -evaluate();
+    if (ply >= MAX_PLY) return standPat;
+
+    bool inCheck = quiescenceEvasions && isInCheck(-1, true);
+
+    // Stand pat, the side to move can usually do at least as well as doing nothing
+    if (!inCheck) {
+        if (standPat >= beta) return standPat;
+        if (standPat > alpha) alpha = standPat;
+    }
 
     Move moveBuffer[MAX_MOVES];
-    int moveCount = GenerateLegalMoves(moveBuffer);
-    if (moveCount == 0) return isInCheck() ? -INF + depth : 0; // checkmate or stalemate
-    
+    int moveCount = inCheck ? GenerateLegalMoves(moveBuffer) : GenerateLegalMoves(moveBuffer, true);
+    if (inCheck && moveCount == 0) return -INF + ply;
+
+    Eval maxEval = inCheck ? -INF : standPat;
+
+    int scores[MAX_MOVES];
+    scoreMoves(moveBuffer, scores, moveCount, 0, ply);
+
     for (int i=0; i<moveCount; i++) {
-        Move move = moveBuffer[i];
+        Move move = pickMove(moveBuffer, scores, moveCount, i);
+
+        // Only captures that lose material on the exchange are left, none are worth searching
+        if (!inCheck && scores[i] < 0) break;
+
+        // Delta pruning, skip captures that cannot lift the score to alpha even with a margin
+        if (!inCheck && getPromotedPiece(move) == NO_PIECE) {
+            U8 captured = (getFlags(move) == EN_PASSANT_FLAG) ? (U8)PAWN : getPieceType(getToSquare(move));
+            if (standPat + pieceValues[captured] + DELTA_MARGIN <= alpha) continue;
+        }
 
         makeMove(move);
-        Eval eval = -negaMax(depth - 1, -beta, -alpha);
+        Eval eval = -quiescence(-beta, -alpha, ply + 1);
         undoMove();
 
-        if (eval >= beta)
-            return beta;
+        if (stopped) return 0;
+
         if (eval > maxEval)
             maxEval = eval;
         if (eval > alpha)
             alpha = eval;
+        if (alpha >= beta)
+            break;
+    }
+
+    return maxEval;
+}
+
+Eval Chess::negaMax(int depth, int alpha, int beta, int ply) {
+    if (ply > 0 && isDraw()) return 0;
+    if (depth==0) return quiescence(alpha, beta, ply);
+
+    nodes++;
+    if (ply > 0 && checkStop()) return 0;
+
+    int alphaOrig = alpha;
+    Move ttMove = 0;
+
+    if (tt) {
+        TTData entry;
+        if (tt->probe(hashKey, entry)) {
+            ttMove = entry.move;
+            int score = scoreFromTT(entry.score, ply);
+            U8 bound = entry.bound;
 
+            // Never cut at the root, the caller wants a move
+            if (ply > 0 && entry.depth >= depth &&
+                (bound == BOUND_EXACT ||
+                (bound == BOUND_LOWER && score >= beta) ||
+                (bound == BOUND_UPPER && score <= alpha)))
+                return score;
+        }
+    }
+
+    Move moveBuffer[MAX_MOVES];
+    int moveCount = GenerateLegalMoves(moveBuffer);
+    if (moveCount == 0) return isInCheck(-1, true) ? -INF + ply : 0; // checkmate or stalemate
+
+    int scores[MAX_MOVES];
+    scoreMoves(moveBuffer, scores, moveCount, ttMove, ply);
+
+    int maxEval = -INF;
+    Move best = 0;
+
+    for (int i=0; i<moveCount; i++) {
+        Move move = pickMove(moveBuffer, scores, moveCount, i);
+
+        makeMove(move);
+        Eval eval = -negaMax(depth - 1, -beta, -alpha, ply + 1);
+        undoMove();
+
+        // The subtree was cut short, its score means nothing
+        if (stopped) break;
+
+        if (eval > maxEval) {
+            maxEval = eval;
+            best = move;
+        }
+        if (eval > alpha)
+            alpha = eval;
+        if (alpha >= beta) {
+            if (!isCaptureMove(move) && getPromotedPiece(move) == NO_PIECE) updateQuietStats(move, depth, ply);
+            break;
+        }
+
+    }
+
+    if (ply == 0 && !stopped) bestMove = best;
+    if (stopped) return 0;
+
+    if (tt) {
+        U8 bound = maxEval >= beta ? BOUND_LOWER : (maxEval > alphaOrig ? BOUND_EXACT : BOUND_UPPER);
+        tt->store(hashKey, scoreToTT(maxEval, ply), best, depth, bound);
     }
     
     return maxEval;
-}
\ No newline at end of file
+}
+
+
+std::string Chess::formatScore(int score) {
+    if (score >= MATE_BOUND) return "mate " + std::to_string((INF - score + 1) / 2);
+    if (score <= -MATE_BOUND) return "mate -" + std::to_string((INF + score) / 2);
+    return "cp " + std::to_string(score);
+}
+
+// Lazy SMP depth staggering, helper n skips the depths where ((depth + phase) / size) is odd
+static const int skipSize[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skipPhase[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+SearchResult Chess::search(const SearchLimits& searchLimits, bool report) {
+    limits = searchLimits;
+    nodes = 0;
+    stopped = false;
+    searchStart = std::chrono::steady_clock::now();
+    searchRoot = stackPointer;
+    gameStateStack.resize(std::max(gameStateStack.size(), (size_t)stackPointer + MAX_PLY + 1)); // Room for every search ply
+    if (tt) tt->newSearch();
+    resetOrdering();
+
+    // Helpers search their own copies and only meet the main thread through the table
+    int helperCount = tt ? std::max(0, threads - 1) : 0;
+    std::atomic<bool> helpersStop{false};
+    std::vector<Chess*> helpers;
+    std::vector<SearchResult> helperResults(helperCount);
+    std::vector<std::thread> pool;
+
+    while ((int)helperPawnTables.tables.size() < helperCount) helperPawnTables.tables.push_back(new PawnTable());
+
+    for (int t = 0; t < helperCount; t++) {
+        Chess* helper = new Chess(*this);
+        std::swap(helper->pawnTable.entries, helperPawnTables.tables[t]->entries);
+        helper->limits = SearchLimits{limits.depth};
+        helper->stopSignal = &helpersStop;
+        helpers.push_back(helper);
+        pool.emplace_back([helper, t, &helperResults]() { helperResults[t] = helper->iterativeDeepening(t + 1, false); });
+    }
+
+    SearchResult result = iterativeDeepening(0, report);
+
+    helpersStop = true;
+    for (std::thread& t : pool) t.join();
+
+    // A helper that completed a deeper iteration has the better answer
+    for (int t = 0; t < helperCount; t++) {
+        SearchResult& helperResult = helperResults[t];
+        if (helperResult.bestMove && helperResult.depth > result.depth) {
+            result.bestMove = helperResult.bestMove;
+            result.score = helperResult.score;
+            result.depth = helperResult.depth;
+        }
+        result.nodes += helperResult.nodes;
+        std::swap(helpers[t]->pawnTable.entries, helperPawnTables.tables[t]->entries);
+        delete helpers[t];
+    }
+
+    result.ms = elapsedMs();
+    bestMove = result.bestMove;
+
+    return result;
+}
+
+SearchResult Chess::iterativeDeepening(int threadId, bool report) {
+    SearchResult result;
+
+    // Fall back to any legal move if not even depth 1 completes
+    Move moveBuffer[MAX_MOVES];
+    if (GenerateLegalMoves(moveBuffer) > 0) result.bestMove = moveBuffer[0];
+
+    int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_PLY) : MAX_PLY;
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        if (threadId > 0) {
+            int i = (threadId - 1) % 20;
+            if (((depth + skipPhase[i]) / skipSize[i]) % 2) continue;
+        }
+
+        bestMove = 0;
+        int score = negaMax(depth, -INF, INF);
+
+        // Keep only completed iterations
+        if (stopped) break;
+
+        result.bestMove = bestMove ? bestMove : result.bestMove;
+        result.score = score;
+        result.depth = depth;
+
+        double ms = elapsedMs();
+        if (report) {
+            std::cout << "info depth " << depth << " score " << formatScore(score) << " nodes " << nodes
+                      << " nps " << (uint64_t)(nodes * 1000 / std::max(ms, 1.0)) << " time " << (uint64_t)ms
+                      << " pv " << notationFromSquare(result.bestMove) << std::endl;
+        }
+
+        // A mate was found, deeper iterations won't change it
+        if (score >= MATE_BOUND || score <= -MATE_BOUND) break;
+
+        // The next iteration would almost certainly not finish in time
+        if (limits.movetime && ms * 2 >= limits.movetime) break;
+    }
+
+    result.nodes = nodes;
+    result.ms = elapsedMs();
+
+    return result;
+}
@@ -0,0 +1,67 @@
+#include "chess.h"
+
+// Static exchange evaluation, the material outcome of the capture sequence on the
+// target square with both sides always recapturing with their least valuable piece.
+// Pins are ignored, sliders behind a capturing piece join in as x-rays.
+int Chess::see(Move move) {
+    U8 from = getFromSquare(move);
+    U8 to = getToSquare(move);
+    if (getFlags(move) == CASTLE_FLAG) return 0;
+
+    Bitboard occ = allPieces ^ getWithSetBit(from);
+    U8 onSquare = getPieceType(from);
+    int gain[32];
+
+    if (getFlags(move) == EN_PASSANT_FLAG) {
+        occ ^= getWithSetBit(currentTurn ? to - 8 : to + 8);
+        gain[0] = pieceValues[PAWN];
+    } else {
+        gain[0] = pieceValues[getPieceType(to)];
+    }
+
+    U8 promoted = getPromotedPiece(move);
+    if (promoted != NO_PIECE) {
+        gain[0] += pieceValues[promoted] - pieceValues[PAWN];
+        onSquare = promoted;
+    }
+
+    Bitboard diagonalSliders = bitboards[BISHOP][WHITE] | bitboards[BISHOP][BLACK] | bitboards[QUEEN][WHITE] | bitboards[QUEEN][BLACK];
+    Bitboard straightSliders = bitboards[ROOK][WHITE] | bitboards[ROOK][BLACK] | bitboards[QUEEN][WHITE] | bitboards[QUEEN][BLACK];
+
+    Bitboard attackers = attackersTo(to, occ) & occ;
+    U8 side = !currentTurn;
+    int depth = 0;
+
+    while (depth < 31) {
+        Bitboard ours = attackers & (side ? whitePieces : blackPieces);
+        if (!ours) break;
+
+        U8 piece = PAWN;
+        while (!(ours & bitboards[piece][side])) piece++;
+
+        // The king may only take last
+        if (piece == KING && (attackers & (side ? blackPieces : whitePieces))) break;
+
+        depth++;
+        gain[depth] = pieceValues[onSquare] - gain[depth - 1];
+
+        Bitboard fromSquare = ours & bitboards[piece][side];
+        occ ^= fromSquare & -fromSquare;
+
+        // Uncover sliders lined up behind the piece that just captured
+        if (piece == PAWN || piece == BISHOP || piece == QUEEN) attackers |= bishopAttacks(to, occ) & diagonalSliders;
+        if (piece == ROOK || piece == QUEEN) attackers |= rookAttacks(to, occ) & straightSliders;
+        attackers &= occ;
+
+        onSquare = piece;
+        side = !side;
+    }
+
+    // Either side may stop capturing when continuing would lose material
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+
+    return gain[0];
+}
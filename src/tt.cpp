@@ -0,0 +1,164 @@
+#include "chess.h"
+
+TranspositionTable::~TranspositionTable() {
+    delete[] buckets;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    delete[] buckets;
+    buckets = nullptr; // Still valid for the destructor if the allocation below throws
+
+    bucketCount = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(TTBucket));
+    buckets = new TTBucket[bucketCount];
+    clear();
+}
+
+void TranspositionTable::clear() {
+    memset(static_cast<void*>(buckets), 0, bucketCount * sizeof(TTBucket));
+    generation = 0;
+}
+
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & 63;
+}
+
+TTBucket* TranspositionTable::bucket(Key key) {
+    // Maps the low half of the key onto [0, bucketCount) without a modulo
+    return &buckets[((key & 0xffffffffULL) * bucketCount) >> 32];
+}
+
+void TranspositionTable::prefetch(Key key) {
+    __builtin_prefetch(bucket(key));
+}
+
+static uint64_t packEntry(int score, Move move, int depth, U8 genBound) {
+    return (uint64_t)(uint32_t)score | (uint64_t)move << 32 | (uint64_t)(U8)depth << 48 | (uint64_t)genBound << 56;
+}
+
+static U8 entryDepth(uint64_t data) { return (data >> 48) & 0xff; }
+static U8 entryGenBound(uint64_t data) { return data >> 56; }
+
+// Relaxed is enough, the XOR check catches entries written halfway by another thread
+bool TranspositionTable::probe(Key key, TTData& result) {
+    TTEntry* entries = bucket(key)->entries;
+
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = entries[i].data.load(std::memory_order_relaxed);
+        if ((entries[i].keyXor.load(std::memory_order_relaxed) ^ data) != key || !entryGenBound(data)) continue;
+
+        result.score = (int32_t)(uint32_t)data;
+        result.move = (data >> 32) & 0xffff;
+        result.depth = entryDepth(data);
+        result.bound = entryGenBound(data) & 3;
+
+        // Refresh age
+        uint64_t refreshed = packEntry(result.score, result.move, result.depth, (generation << 2) | result.bound);
+        entries[i].data.store(refreshed, std::memory_order_relaxed);
+        entries[i].keyXor.store(key ^ refreshed, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(Key key, int score, Move move, int depth, U8 bound) {
+    TTEntry* entries = bucket(key)->entries;
+    TTEntry* replace = nullptr;
+    uint64_t old = 0;
+
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = entries[i].data.load(std::memory_order_relaxed);
+        if ((entries[i].keyXor.load(std::memory_order_relaxed) ^ data) == key) {
+            replace = &entries[i];
+            old = data;
+            break;
+        }
+    }
+
+    if (replace) {
+        // Keep the old move when the new search did not produce one
+        if (!move) move = (old >> 32) & 0xffff;
+
+        // Don't let a shallow bound overwrite deeper information about the same position
+        if (bound != BOUND_EXACT && depth + 2 <= entryDepth(old)) {
+            if (move == ((old >> 32) & 0xffff)) return;
+            score = (int32_t)(uint32_t)old;
+            depth = entryDepth(old);
+            bound = entryGenBound(old) & 3;
+        }
+    } else {
+        // Replace the shallowest entry, counting older searches as shallower
+        int worst = 1 << 30;
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            uint64_t data = entries[i].data.load(std::memory_order_relaxed);
+            int age = (generation - (entryGenBound(data) >> 2)) & 63;
+            int value = entryDepth(data) - 8 * age;
+            if (value < worst) {
+                worst = value;
+                replace = &entries[i];
+            }
+        }
+    }
+
+    uint64_t data = packEntry(score, move, depth, (generation << 2) | bound);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->keyXor.store(key ^ data, std::memory_order_relaxed);
+}
+
+
+PerftTable::~PerftTable() {
+    delete[] buckets;
+}
+
+void PerftTable::resize(size_t megabytes) {
+    delete[] buckets;
+
+    bucketCount = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(PerftBucket));
+    buckets = new PerftBucket[bucketCount];
+    clear();
+}
+
+void PerftTable::clear() {
+    memset(static_cast<void*>(buckets), 0, bucketCount * sizeof(PerftBucket));
+}
+
+bool PerftTable::probe(Key key, int depth, uint64_t& nodes) {
+    PerftEntry* entries = buckets[key % bucketCount].entries;
+
+    for (int i = 0; i < PERFT_BUCKET_SIZE; i++) {
+        if (entries[i].key == key && (entries[i].data & 0xff) == (uint64_t)depth) {
+            nodes = entries[i].data >> 8;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerftTable::store(Key key, int depth, uint64_t nodes) {
+    PerftEntry* entries = buckets[key % bucketCount].entries;
+
+    // Deeper subtrees are worth more, replace the shallowest
+    PerftEntry* replace = &entries[0];
+    for (int i = 1; i < PERFT_BUCKET_SIZE; i++) {
+        if ((entries[i].data & 0xff) < (replace->data & 0xff)) replace = &entries[i];
+    }
+
+    replace->key = key;
+    replace->data = (nodes << 8) | depth;
+}
+
+
+PawnTable& PawnTable::operator=(const PawnTable&) {
+    delete[] entries;
+    entries = nullptr;
+    return *this;
+}
+
+PawnTable::~PawnTable() {
+    delete[] entries;
+}
+
+// Zeroed entries already hold the correct result for key 0, a position without pawns
+PawnEntry* PawnTable::probe(Key key) {
+    if (!entries) entries = new PawnEntry[PAWN_TABLE_SIZE]();
+    return &entries[key & (PAWN_TABLE_SIZE - 1)];
+}
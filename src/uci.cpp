@@ -0,0 +1,161 @@
+#include "chess.h"
+#include <sstream>
+#include <thread>
+#include <cerrno>
+
+static const std::string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static void setPosition(Chess* Board, std::stringstream& tokens) {
+    std::string token, fen;
+    tokens >> token;
+
+    if (token == "startpos") {
+        fen = startFen;
+        tokens >> token; // "moves"
+    } else if (token == "fen") {
+        while (tokens >> token && token != "moves") fen += token + " ";
+    } else {
+        return;
+    }
+
+    if (!Chess::isValidFen(fen)) {
+        std::cout << "info string invalid fen" << std::endl;
+        return;
+    }
+    Board->loadFen(fen);
+
+    // Game moves stay on the stack, the search looks back through them for repetitions
+    while (tokens >> token) {
+        Move move = Board->parseMove(token);
+        if (!move) {
+            std::cout << "info string illegal move " << token << std::endl;
+            break;
+        }
+        Board->makeMove(move);
+    }
+}
+
+// A spin option's value clamped to [min, max], false if it is not a number
+static bool parseSpin(const std::string& value, int64_t min, int64_t max, int64_t& result) {
+    char* end;
+    errno = 0;
+    long long parsed = strtoll(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') return false;
+    result = errno == ERANGE ? (parsed < 0 ? min : max) : std::clamp<int64_t>(parsed, min, max);
+    return true;
+}
+
+static SearchLimits parseGo(Chess* Board, std::stringstream& tokens, bool& infinite) {
+    SearchLimits limits;
+    std::string token;
+    int64_t time[2] = {0, 0}, increment[2] = {0, 0};
+    int movesToGo = 0;
+    infinite = false;
+
+    while (tokens >> token) {
+        if (token == "depth") tokens >> limits.depth;
+        else if (token == "nodes") tokens >> limits.nodes;
+        else if (token == "movetime") tokens >> limits.movetime;
+        else if (token == "wtime") tokens >> time[WHITE];
+        else if (token == "btime") tokens >> time[BLACK];
+        else if (token == "winc") tokens >> increment[WHITE];
+        else if (token == "binc") tokens >> increment[BLACK];
+        else if (token == "movestogo") tokens >> movesToGo;
+        else if (token == "infinite") infinite = true;
+    }
+
+    // Spend an even share of the clock, keeping a margin for communication
+    U8 us = Board->currentTurn;
+    if (!limits.movetime && time[us] > 0) {
+        int64_t share = time[us] / (movesToGo > 0 ? movesToGo : 30) + increment[us] / 2;
+        limits.movetime = std::max<int64_t>(1, std::min(share, time[us] - 50));
+    }
+
+    return limits;
+}
+
+void runUCI(size_t hashMegabytes, std::string firstCommand) {
+    TranspositionTable table;
+    table.resize(hashMegabytes);
+
+    std::atomic<bool> stop{false};
+    std::thread searchThread;
+
+    Chess* Board = new Chess();
+    Board->init(startFen);
+    Board->tt = &table;
+    Board->stopSignal = &stop;
+
+    auto stopSearch = [&]() {
+        stop = true;
+        if (searchThread.joinable()) searchThread.join();
+    };
+
+    // A command already read by the menu interface is handled first
+    std::string line = firstCommand;
+    while (!line.empty() || getline(std::cin, line)) {
+        std::stringstream tokens(line);
+        std::string command;
+        tokens >> command;
+
+        if (command == "uci") {
+            std::cout << "id name Reaver Chess" << std::endl;
+            std::cout << "id author Fadil Elbshari" << std::endl;
+            std::cout << "option name Hash type spin default " << hashMegabytes << " min 1 max 65536" << std::endl;
+            std::cout << "option name Threads type spin default 1 min 1 max 256" << std::endl;
+            std::cout << "option name EvalFile type string default <empty>" << std::endl;
+            std::cout << "uciok" << std::endl;
+        } else if (command == "isready") {
+            std::cout << "readyok" << std::endl;
+        } else if (command == "setoption") {
+            stopSearch();
+            std::string token, name, value;
+            tokens >> token; // "name"
+            while (tokens >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+            tokens >> value;
+
+            int64_t spin;
+            if (name == "Hash" && parseSpin(value, 1, 65536, spin)) {
+                try {
+                    table.resize(spin);
+                } catch (const std::bad_alloc&) {
+                    table.resize(1);
+                    std::cout << "info string could not allocate " << spin << " MB of hash, using 1 MB" << std::endl;
+                }
+            } else if (name == "Threads" && parseSpin(value, 1, 256, spin)) Board->threads = spin;
+            else if (name == "EvalFile" && !value.empty()) {
+                if (Chess::loadNetwork(value)) Board->refreshAccumulator();
+                else std::cout << "info string could not load network " << value << std::endl;
+            }
+        } else if (command == "ucinewgame") {
+            stopSearch();
+            table.clear();
+        } else if (command == "position") {
+            stopSearch();
+            setPosition(Board, tokens);
+        } else if (command == "go") {
+            stopSearch();
+            bool infinite;
+            SearchLimits limits = parseGo(Board, tokens, infinite);
+            stop = false;
+
+            searchThread = std::thread([Board, limits, infinite, &stop]() {
+                SearchResult result = Board->search(limits);
+
+                // 'go infinite' must not answer before 'stop'
+                while (infinite && !stop) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                std::cout << "bestmove " << (result.bestMove ? Board->notationFromSquare(result.bestMove) : "0000") << std::endl;
+            });
+        } else if (command == "stop") {
+            stopSearch();
+        } else if (command == "quit") {
+            break;
+        }
+
+        line.clear();
+    }
+
+    stopSearch();
+    delete Board;
+}
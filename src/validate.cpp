@@ -1,4 +1,28 @@
 #include "chess.h"
+#include <cctype>
+
+bool Chess::isSquareAttacked(int square, U8 byColor, Bitboard occ) {
+    if(pawnAttacks[!byColor][square] & bitboards[PAWN][byColor]) return true;
+    if(knightAttacks[square] & bitboards[KNIGHT][byColor]) return true;
+    if(kingAttacks[square] & bitboards[KING][byColor]) return true;
+    if(rookAttacks(square, occ) & (bitboards[ROOK][byColor] | bitboards[QUEEN][byColor])) return true;
+    if(bishopAttacks(square, occ) & (bitboards[BISHOP][byColor] | bitboards[QUEEN][byColor])) return true;
+
+    return false;
+}
+
+// Pieces of both colours attacking the square, sliders seen through the given occupancy
+Bitboard Chess::attackersTo(int square, Bitboard occ) {
+    Bitboard diagonalSliders = bitboards[BISHOP][WHITE] | bitboards[BISHOP][BLACK] | bitboards[QUEEN][WHITE] | bitboards[QUEEN][BLACK];
+    Bitboard straightSliders = bitboards[ROOK][WHITE] | bitboards[ROOK][BLACK] | bitboards[QUEEN][WHITE] | bitboards[QUEEN][BLACK];
+
+    return (pawnAttacks[WHITE][square] & bitboards[PAWN][BLACK])
+         | (pawnAttacks[BLACK][square] & bitboards[PAWN][WHITE])
+         | (knightAttacks[square] & (bitboards[KNIGHT][WHITE] | bitboards[KNIGHT][BLACK]))
+         | (kingAttacks[square] & (bitboards[KING][WHITE] | bitboards[KING][BLACK]))
+         | (bishopAttacks(square, occ) & diagonalSliders)
+         | (rookAttacks(square, occ) & straightSliders);
+}
 
 bool Chess::isInCheck(int kingsqr, bool flip) {
     bool isWhite = (kingsqr == -1) ? !currentTurn : currentTurn;
@@ -6,108 +30,170 @@ bool Chess::isInCheck(int kingsqr, bool flip) {
 
     int K_SQUARE = (kingsqr == -1) ? kingSquare[isWhite] : kingsqr;
 
-    if(pawnAttacks[isWhite][K_SQUARE] & bitboards[PAWN][!isWhite]) return true;
-    if(knightAttacks[K_SQUARE] & bitboards[KNIGHT][!isWhite]) return true;
-    if(kingAttacks[K_SQUARE] & bitboards[KING][!isWhite]) return true;
-    if(rookAttacks(K_SQUARE, allPieces) & (bitboards[ROOK][!isWhite] | bitboards[QUEEN][!isWhite])) return true;
-    if(bishopAttacks(K_SQUARE, allPieces) & (bitboards[BISHOP][!isWhite] | bitboards[QUEEN][!isWhite])) return true;
-
-
-    return false;
+    return isSquareAttacked(K_SQUARE, !isWhite, allPieces);
 }
 
 bool Chess::isLegalMove(U8 from, U8 to, int promotionPiece) {
 
-    int moveCount = 0;
-    U8 pieceType = getPieceType(from);
-    U8 pieceColor = getPieceColor(from);
-
-    if (pieceType==NO_PIECE || pieceColor!=currentTurn) return false;
-
     Move moveBuffer[MAX_MOVES];
-    if (pieceType==PAWN) {
-        moveCount = getPawnMoves(moveBuffer, from);
-    } else if (pieceType==BISHOP) {
-        moveCount = getBishopMoves(moveBuffer, from);
-    } else if (pieceType==KNIGHT) {
-        moveCount = getKnightMoves(moveBuffer, from);
-    } else if (pieceType==ROOK) {
-        moveCount = getRookMoves(moveBuffer, from);
-    } else if (pieceType==QUEEN) {
-        moveCount = getQueenMoves(moveBuffer, from);
-    } else if (pieceType==KING) {
-        moveCount = getKingMoves(moveBuffer, from);
-    } 
-
-    // Perform "Checks" and possible "Pins"
-    bool isLegal=false;
+    int moveCount = GenerateLegalMoves(moveBuffer);
+
     for (int i=0; i<moveCount; i++) {
         Move move = moveBuffer[i];
-        
-        if(getFromSquare(move) == from && getToSquare(move) == to && promotionPiece == getPromotedPiece(move)) {
 
+        if(getFromSquare(move) == from && getToSquare(move) == to && promotionPiece == getPromotedPiece(move)) {
             makeMove(move);
-            isLegal = (isInCheck() ? false : true);
-            
-            if (!isLegal){
-                undoMove();
-            }
+            return true;
         }
     }
 
-    
-    return isLegal;
+    return false;
 
 }
 
 bool Chess::isCheckMate() {
     if (!isInCheck(-1, true)) return false;
-        Move moveBuffer[MAX_MOVES];
-
-        int moveCount = GenerateMoves(moveBuffer);
-
-        for (int i=0; i<moveCount; i++) {
-            Move move = moveBuffer[i];
-            makeMove(move);
-            bool isLegal = !isInCheck();
-            undoMove();
-            if (isLegal) return false;
-        }
+    Move moveBuffer[MAX_MOVES];
 
-        return true;
-    } 
+    return GenerateLegalMoves(moveBuffer) == 0;
+}
 
 bool Chess::isStaleMate() {
     if (isInCheck(-1, true)) return false;
-        Move moveBuffer[MAX_MOVES];
-
-        int moveCount = GenerateMoves(moveBuffer);
-        for (int i=0; i<moveCount; i++) {
-            Move move = moveBuffer[i];
-            makeMove(move);
-            bool isLegal = !isInCheck();
-            undoMove();
-            if (isLegal) return false;
-        }
+    Move moveBuffer[MAX_MOVES];
 
-        return true;
-    }
+    return GenerateLegalMoves(moveBuffer) == 0;
+}
 
 U8 Chess::isGameOver() {
 
-    U8 RESULT = STALE_MATE;
-    if (isInCheck(kingSquare[currentTurn])) RESULT=CHECK_MATE;
-
     Move moveBuffer[MAX_MOVES];
+    if (GenerateLegalMoves(moveBuffer) == 0) return isInCheck(-1, true) ? CHECK_MATE : STALE_MATE;
 
-    int moveCount = GenerateMoves(moveBuffer);
-    for (int i=0; i<moveCount; i++) {
-        Move move = moveBuffer[i];
-        makeMove(move);
-        bool isLegal = !isInCheck();
-        undoMove();
-        if (isLegal) return NOT_OVER;
+    if (moveRule50Count >= 100) return FIFTY_MOVES;
+    if (isRepetition(stackPointer)) return REPETITION;
+    return NOT_OVER;
+}
+
+// Looks for the current position among the earlier ones with the same side to move, back to the last
+// capture or pawn move since nothing before it can come again. One earlier occurrence at or after
+// root is enough, before it takes two (threefold repetition).
+bool Chess::isRepetition(int root) {
+    int end = std::max(0, stackPointer - moveRule50Count);
+    int count = 0;
+
+    for (int i = stackPointer - 4; i >= end; i -= 2) {
+        if (gameStateStack[i].hashKey != hashKey) continue;
+        if (i >= root || ++count == 2) return true;
+    }
+    return false;
+}
 
+// Drawn for the search: fifty moves without a capture or pawn move (unless that last move mated),
+// or a repetition
+bool Chess::isDraw() {
+    if (moveRule50Count >= 100) {
+        Move moveBuffer[MAX_MOVES];
+        return !isInCheck(-1, true) || GenerateLegalMoves(moveBuffer) > 0;
     }
-    return RESULT;
-}
\ No newline at end of file
+    return isRepetition(searchRoot);
+}
+
+// Whether the king of the given color stands attacked on a mailbox of FEN letters, a1 first
+static bool isKingAttacked(const char* squares, bool white) {
+    char king = white ? 'K' : 'k';
+    int square = 0;
+    while (squares[square] != king) square++;
+    int file = square % 8, rank = square / 8;
+
+    auto at = [&](int df, int dr) -> char {
+        int f = file + df, r = rank + dr;
+        return (f < 0 || f > 7 || r < 0 || r > 7) ? '\0' : squares[r * 8 + f];
+    };
+    auto enemy = [&](char piece) -> char { return white ? piece : (char)toupper(piece); }; // piece in lower case
+
+    int forward = white ? 1 : -1;
+    if (at(-1, forward) == enemy('p') || at(1, forward) == enemy('p')) return true;
+
+    static const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    static const int around[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+    for (int i = 0; i < 8; i++) {
+        if (at(knight[i][0], knight[i][1]) == enemy('n') || at(around[i][0], around[i][1]) == enemy('k')) return true;
+
+        // Even entries of 'around' are rook directions, odd ones bishop directions
+        char slider = i % 2 ? enemy('b') : enemy('r');
+        for (int step = 1; step < 8; step++) {
+            char piece = at(around[i][0] * step, around[i][1] * step);
+            if (piece == ' ') continue;
+            if (piece == slider || piece == enemy('q')) return true;
+            break;
+        }
+    }
+    return false;
+}
+
+// loadFen trusts its input, anything from outside should pass through here first. Besides the
+// syntax it rejects what the move generator cannot cope with: castling rights without the king and
+// rook at home, an en passant square without the pawn that just moved, pawns on the back ranks and
+// a side not to move that is in check.
+bool Chess::isValidFen(std::string_view fen) {
+    std::string_view fields[4];
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++) {
+        pos = fen.find_first_not_of(' ', pos);
+        if (pos == std::string_view::npos) return false;
+        size_t end = std::min(fen.find(' ', pos), fen.size());
+        fields[i] = fen.substr(pos, end - pos);
+        pos = end;
+    }
+    std::string_view board = fields[0], side = fields[1], castling = fields[2], enPassant = fields[3];
+
+    char squares[64];
+    memset(squares, ' ', sizeof(squares));
+
+    int ranks = 1, files = 0, kings[2] = {0, 0};
+    for (char c : board) {
+        if (c == '/') {
+            if (files != 8) return false;
+            ranks++;
+            files = 0;
+        } else if (c >= '1' && c <= '8') {
+            files += c - '0';
+        } else if (std::string_view("PNBRQKpnbrqk").find(c) != std::string_view::npos) {
+            if (files < 8 && ranks <= 8) squares[(8 - ranks) * 8 + files] = c;
+            files++;
+            if (c == 'K') kings[WHITE]++;
+            if (c == 'k') kings[BLACK]++;
+            if ((c == 'P' || c == 'p') && (ranks == 1 || ranks == 8)) return false;
+        } else {
+            return false;
+        }
+        if (files > 8) return false;
+    }
+    if (ranks != 8 || files != 8 || kings[WHITE] != 1 || kings[BLACK] != 1) return false;
+
+    if (side != "w" && side != "b") return false;
+    bool white = side == "w";
+
+    if (castling != "-") {
+        if (castling.find_first_not_of("KQkq") != std::string_view::npos) return false;
+        for (char right : castling) {
+            bool whiteRight = isupper(right);
+            int home = whiteRight ? 0 : 56;
+            int rook = home + (tolower(right) == 'k' ? 7 : 0);
+            if (squares[home + 4] != (whiteRight ? 'K' : 'k') || squares[rook] != (whiteRight ? 'R' : 'r')) return false;
+        }
+    }
+
+    if (enPassant != "-") {
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] != (white ? '6' : '3'))
+            return false;
+        // The pawn that just moved two squares stands in front of it, the squares it crossed are empty
+        int square = (enPassant[1] - '1') * 8 + (enPassant[0] - 'a');
+        int forward = white ? -8 : 8;
+        if (squares[square + forward] != (white ? 'p' : 'P') || squares[square] != ' ' ||
+            squares[square - forward] != ' ') return false;
+    }
+
+    return !isKingAttacked(squares, !white);
+}
@@ -0,0 +1,61 @@
+#include "chess.h"
+#include <mutex>
+
+Key Chess::zobristPieces[6][2][64];
+Key Chess::zobristCastling[16];
+Key Chess::zobristEnPassant[8];
+Key Chess::zobristSide;
+
+static std::once_flag zobristInitialised;
+
+static Key randomKey(Key& seed) {
+    // xorshift64*
+    seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+    return seed * 2685821657736338717ULL;
+}
+
+void Chess::initZobrist() {
+    std::call_once(zobristInitialised, []() {
+        Key seed = 1070372ULL;
+
+        for (int piece = PAWN; piece <= KING; piece++)
+            for (int color = BLACK; color <= WHITE; color++)
+                for (int sq = 0; sq < 64; sq++)
+                    zobristPieces[piece][color][sq] = randomKey(seed);
+
+        // One key per castling-rights combination, built from the four single-right keys
+        Key rights[4];
+        for (int i = 0; i < 4; i++) rights[i] = randomKey(seed);
+        for (int cr = 0; cr < 16; cr++) {
+            zobristCastling[cr] = 0ULL;
+            for (int i = 0; i < 4; i++)
+                if (cr & (1 << i)) zobristCastling[cr] ^= rights[i];
+        }
+
+        for (int file = 0; file < 8; file++) zobristEnPassant[file] = randomKey(seed);
+        zobristSide = randomKey(seed);
+    });
+}
+
+// The en passant file only counts when the side to move can actually capture
+Key Chess::enPassantKey() {
+    if (enPassantSquare == 64) return 0ULL;
+    if (!(pawnAttacks[!currentTurn][enPassantSquare] & bitboards[PAWN][currentTurn])) return 0ULL;
+
+    return zobristEnPassant[getFile(enPassantSquare)];
+}
+
+Key Chess::computeHash() {
+    Key key = 0ULL;
+
+    for (int sq = 0; sq < 64; sq++) {
+        U8 code = pieceLocations[sq];
+        if (code != EMPTY_SQUARE) key ^= zobristPieces[code >> 1][code & 1][sq];
+    }
+
+    key ^= zobristCastling[castlingRights];
+    key ^= enPassantKey();
+    if (currentTurn) key ^= zobristSide;
+
+    return key;
+}